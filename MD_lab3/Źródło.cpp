@@ -4,6 +4,21 @@
 #include <stdexcept>
 #include <fstream>
 #include <iomanip>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <unordered_map>
+#include <chrono>
+#include <array>
+
+#include "CounterRng.h"
 
 using namespace std;
 
@@ -20,172 +35,1605 @@ vector<int> ruleToBinary(int rule)
     return binaryRule;
 }
 
-int applyRule(const vector<int>& binaryRule, int left, int center, int right)
+// Rodzaj reguy: pena tablica (indeks = stany ssiedztwa zapisane jako liczba
+// o podstawie States, od lewej) albo totalistyczna (indeks = suma stanw ssiedztwa)
+enum class RuleKind { Full, Totalistic };
+
+constexpr size_t integerPower(size_t base, int exponent)
 {
-    int index = (left << 2) | (center << 1) | right;
-    return binaryRule[index];
+    return exponent == 0 ? 1 : base * integerPower(base, exponent - 1);
 }
 
-void updateCells(vector<int>& cells, const vector<int>& binaryRule) 
+template <int Radius, int States, RuleKind Kind>
+struct RuleTable
 {
-    vector<int> newCells(cells.size());
+    static constexpr int NEIGHBORHOOD = 2 * Radius + 1;
+    static constexpr size_t SIZE = Kind == RuleKind::Full
+        ? integerPower(States, NEIGHBORHOOD)
+        : size_t(NEIGHBORHOOD) * (States - 1) + 1;
 
-    // Zachowanie pierwszej i ostatniej komrki
-    newCells[0] = cells[0];
-    newCells[cells.size() - 1] = cells[cells.size() - 1]; 
+    array<uint8_t, SIZE> next{};
 
-    for (size_t i = 1; i < cells.size() - 1; ++i)
+    // Tablica z kodu reguy: cyfra i kodu (o podstawie States) to nowy stan dla indeksu i
+    static constexpr RuleTable fromCode(uint64_t code)
     {
-        newCells[i] = applyRule(binaryRule, cells[i - 1], cells[i], cells[i + 1]);
+        RuleTable table;
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            table.next[i] = static_cast<uint8_t>(code % States);
+            code /= States;
+        }
+        return table;
     }
+};
 
-    cells = newCells; 
+using ElementaryRuleTable = RuleTable<1, 2, RuleKind::Full>;
+
+// Regua elementarna w numeracji ruleToBinary: wzorzec (l, c, r) daje bit 7 - (4l + 2c + r)
+constexpr ElementaryRuleTable elementaryRuleTable(int rule)
+{
+    ElementaryRuleTable table;
+    for (size_t i = 0; i < ElementaryRuleTable::SIZE; ++i)
+        table.next[i] = static_cast<uint8_t>((rule >> (7 - i)) & 1);
+    return table;
 }
 
-void updateCellsPeriodic(vector<int>& cells, const vector<int>& binaryRule)
+static_assert(elementaryRuleTable(190).next[0] == 1 && elementaryRuleTable(190).next[7] == 0,
+    "Tablica reguly elementarnej musi zgadzac sie z ruleToBinary");
+
+ElementaryRuleTable elementaryRuleTable(const vector<int>& binaryRule)
+{
+    ElementaryRuleTable table;
+    for (size_t i = 0; i < ElementaryRuleTable::SIZE; ++i)
+        table.next[i] = static_cast<uint8_t>(binaryRule[i]);
+    return table;
+}
+
+// Warunki brzegowe jako parametry szablonu. Kady wypenia Radius komrek-duchw po
+// obu stronach wiersza przed krokiem, wic ptla obliczeniowa nie ma rozgazie ani modulo
+
+// Pierwsze i ostatnie Radius komrek nie zmienia si
+template <int Radius>
+struct FixedBoundary
+{
+    static constexpr bool FREEZE_EDGES = true;
+    static constexpr bool WRAPS = false;
+
+    static void fillGhosts(uint8_t* cells, size_t cellCount)
+    {
+        fill(cells - Radius, cells, uint8_t(0));
+        fill(cells + cellCount, cells + cellCount + Radius, uint8_t(0));
+    }
+};
+
+// Wiersz zawinity w piercie
+template <int Radius>
+struct PeriodicBoundary
+{
+    static constexpr bool FREEZE_EDGES = false;
+    static constexpr bool WRAPS = true;
+
+    static void fillGhosts(uint8_t* cells, size_t cellCount)
+    {
+        for (size_t g = 1; g <= Radius; ++g)
+        {
+            cells[-ptrdiff_t(g)] = cells[cellCount - 1 - (g - 1) % cellCount];
+            cells[cellCount + g - 1] = cells[(g - 1) % cellCount];
+        }
+    }
+};
+
+// Poza wierszem same zera
+template <int Radius>
+struct AbsorptiveBoundary
 {
-    vector<int> newCells(cells.size());
-    for (size_t i = 0; i < cells.size(); ++i) 
-    { 
-        int left = cells[(i - 1 + cells.size()) % cells.size()]; 
-        int center = cells[i];
-        int right = cells[(i + 1) % cells.size()];
-        newCells[i] = applyRule(binaryRule, left, center, right);
+    static constexpr bool FREEZE_EDGES = false;
+    static constexpr bool WRAPS = false;
+
+    static void fillGhosts(uint8_t* cells, size_t cellCount)
+    {
+        fill(cells - Radius, cells, uint8_t(0));
+        fill(cells + cellCount, cells + cellCount + Radius, uint8_t(0));
     }
-    cells = newCells;
+};
+
+// Automat 1D o promieniu ssiedztwa Radius i States stanach. Dwa bufory z marginesem
+// komrek-duchw s zamieniane po kadym kroku; nowa rodzina regu to tylko nowa
+// tablica albo nowa specjalizacja szablonu, bez nowej ptli
+template <int Radius, int States, RuleKind Kind, template <int> class BoundaryPolicy>
+class Automaton1D
+{
+public:
+    using Table = RuleTable<Radius, States, Kind>;
+    using Edges = BoundaryPolicy<Radius>;
+
+    Automaton1D(size_t cellCount, const Table& table)
+        : cellCount(cellCount), table(table), current(cellCount + 2 * Radius), next(cellCount + 2 * Radius)
+    {
+    }
+
+    void load(const vector<int>& cells)
+    {
+        for (size_t i = 0; i < cellCount; ++i)
+            current[Radius + i] = static_cast<uint8_t>(cells[i]);
+    }
+
+    void store(vector<int>& cells) const
+    {
+        for (size_t i = 0; i < cellCount; ++i)
+            cells[i] = current[Radius + i];
+    }
+
+    void step()
+    {
+        uint8_t* in = current.data() + Radius;
+        uint8_t* out = next.data() + Radius;
+        Edges::fillGhosts(in, cellCount);
+
+        size_t frozen = Edges::FREEZE_EDGES ? min<size_t>(Radius, (cellCount + 1) / 2) : 0;
+        stepRange(in, out, frozen, cellCount - frozen, table);
+        copy(in, in + frozen, out);
+        copy(in + cellCount - frozen, in + cellCount, out + cellCount - frozen);
+
+        swap(current, next);
+    }
+
+    // Nowe stany komrek [begin, end); in musi mie poprawne komrki w [begin - Radius, end + Radius)
+    static void stepRange(const uint8_t* in, uint8_t* out, size_t begin, size_t end, const Table& table)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            size_t index = 0;
+            for (int offset = -Radius; offset <= Radius; ++offset)
+            {
+                if constexpr (Kind == RuleKind::Full)
+                    index = index * States + in[i + offset];
+                else
+                    index += in[i + offset];
+            }
+            out[i] = table.next[index];
+        }
+    }
+
+    uint8_t* cells() { return current.data() + Radius; }
+    const uint8_t* cells() const { return current.data() + Radius; }
+    size_t size() const { return cellCount; }
+
+private:
+    size_t cellCount;
+    Table table;
+    vector<uint8_t> current;
+    vector<uint8_t> next;
+};
+
+template <template <int> class BoundaryPolicy>
+void updateCellsWith(vector<int>& cells, const vector<int>& binaryRule)
+{
+    Automaton1D<1, 2, RuleKind::Full, BoundaryPolicy> automaton(cells.size(), elementaryRuleTable(binaryRule));
+    automaton.load(cells);
+    automaton.step();
+    automaton.store(cells);
+}
+
+void updateCells(vector<int>& cells, const vector<int>& binaryRule)
+{
+    updateCellsWith<FixedBoundary>(cells, binaryRule);
+}
+
+void updateCellsPeriodic(vector<int>& cells, const vector<int>& binaryRule)
+{
+    updateCellsWith<PeriodicBoundary>(cells, binaryRule);
 }
 
 void updateCellsAbsorptive(vector<int>& cells, const vector<int>& binaryRule)
 {
-    vector<int> newCells(cells.size());
-    for (size_t i = 0; i < cells.size(); ++i) 
+    updateCellsWith<AbsorptiveBoundary>(cells, binaryRule);
+}
+
+// Krokowanie wielu pokole z blokowaniem czasowym. Wiersz dzielony jest na kafelki
+// mieszczce si w pamici podrcznej; kady kafelek razem z marginesem (halo) o
+// szerokoci steps * Radius kopiowany jest do dwch lokalnych buforw i przesuwany
+// o steps pokole naraz (obszar poprawnych komrek zwa si jak trapez). Wszystkie
+// bufory s przydzielane raz, w konstruktorze
+template <int Radius, int States, RuleKind Kind, template <int> class BoundaryPolicy>
+class BlockedStepper1D
+{
+public:
+    using Table = RuleTable<Radius, States, Kind>;
+    using Edges = BoundaryPolicy<Radius>;
+    using Kernel = Automaton1D<Radius, States, Kind, BoundaryPolicy>;
+
+    BlockedStepper1D(size_t cellCount, const Table& table, size_t tileWidth = 4096, int blockSteps = 32)
+        : cellCount(cellCount), table(table), tileWidth(max<size_t>(1, tileWidth)), blockSteps(max(1, blockSteps)),
+          current(cellCount), next(cellCount),
+          tileA(this->tileWidth + 2 * size_t(this->blockSteps) * Radius),
+          tileB(this->tileWidth + 2 * size_t(this->blockSteps) * Radius)
     {
-        int left = (i == 0) ? 0 : cells[i - 1]; // Lewy ssiad, 0 dla pierwszej komrki
-        int center = cells[i]; // Obecna komrka
-        int right = (i == cells.size() - 1) ? 0 : cells[i + 1]; // Prawy ssiad, 0 dla ostatniej komrki
+    }
 
-        newCells[i] = applyRule(binaryRule, left, center, right); 
+    void load(const vector<int>& cells)
+    {
+        for (size_t i = 0; i < cellCount; ++i)
+            current[i] = static_cast<uint8_t>(cells[i]);
+    }
+
+    void store(vector<int>& cells) const
+    {
+        for (size_t i = 0; i < cellCount; ++i)
+            cells[i] = current[i];
+    }
+
+    void advance(uint64_t generations)
+    {
+        while (generations > 0)
+        {
+            int steps = static_cast<int>(min<uint64_t>(generations, blockSteps));
+            advanceBlock(steps);
+            generations -= steps;
+        }
+    }
+
+    const uint8_t* cells() const { return current.data(); }
+
+private:
+    void advanceBlock(int steps)
+    {
+        ptrdiff_t n = static_cast<ptrdiff_t>(cellCount);
+        ptrdiff_t halo = ptrdiff_t(steps) * Radius;
+
+        // Komrki, ktre w ogle s liczone (reszta to stae krawdzie lub duchy)
+        ptrdiff_t frozen = Edges::FREEZE_EDGES ? min<ptrdiff_t>(Radius, (n + 1) / 2) : 0;
+        ptrdiff_t computeBegin = frozen;
+        ptrdiff_t computeEnd = n - frozen;
+
+        for (ptrdiff_t tileBegin = 0; tileBegin < n; tileBegin += ptrdiff_t(tileWidth))
+        {
+            ptrdiff_t tileEnd = min(n, tileBegin + ptrdiff_t(tileWidth));
+            ptrdiff_t localBegin = tileBegin - halo; // Indeks globalny pierwszej komrki bufora
+            ptrdiff_t localSize = tileEnd - tileBegin + 2 * halo;
+
+            for (ptrdiff_t i = 0; i < localSize; ++i)
+                tileA[i] = tileB[i] = cellAt(localBegin + i);
+
+            uint8_t* in = tileA.data();
+            uint8_t* out = tileB.data();
+            for (int s = 1; s <= steps; ++s)
+            {
+                ptrdiff_t begin = localBegin + ptrdiff_t(s) * Radius;
+                ptrdiff_t end = tileEnd + halo - ptrdiff_t(s) * Radius;
+                if (!Edges::WRAPS)
+                {
+                    begin = max(begin, computeBegin);
+                    end = min(end, computeEnd);
+                }
+                if (begin < end)
+                    Kernel::stepRange(in, out, size_t(begin - localBegin), size_t(end - localBegin), table);
+                swap(in, out);
+            }
+
+            copy(in + halo, in + halo + (tileEnd - tileBegin), next.begin() + tileBegin);
+        }
+        swap(current, next);
     }
-    cells = newCells; 
-}
+
+    // Stan komrki o indeksie globalnym, take poza wierszem (wedug warunku brzegowego)
+    uint8_t cellAt(ptrdiff_t i) const
+    {
+        ptrdiff_t n = static_cast<ptrdiff_t>(cellCount);
+        if (i >= 0 && i < n)
+            return current[i];
+        if (Edges::WRAPS)
+            return current[((i % n) + n) % n];
+        return 0;
+    }
+
+    size_t cellCount;
+    Table table;
+    size_t tileWidth;
+    int blockSteps;
+    vector<uint8_t> current;
+    vector<uint8_t> next;
+    vector<uint8_t> tileA;
+    vector<uint8_t> tileB;
+};
 
 // Funkcja do wywietlania stanu komrek
 void displayCells(const vector<int>& cells)
 {
-    for (int cell : cells) 
+    string line(cells.size() + 1, '\n');
+    for (size_t i = 0; i < cells.size(); ++i)
     {
-        cout << (cell ? '#' : '.');
+        line[i] = cells[i] ? '#' : '.';
     }
-    cout << endl;
+    cout << line;
+}
+
+// Liczba 64-bitowych sw potrzebna na jeden spakowany wiersz
+size_t packedWordCount(size_t cellCount)
+{
+    return (cellCount + 63) / 64;
 }
 
-void saveToTXT(const vector<int>& cells, int step, const string& filename, int rule) 
+// Pakowanie wiersza: komrka i trafia do bitu (i % 64) sowa i / 64
+void packCells(const vector<int>& cells, uint64_t* words)
 {
+    size_t wordCount = packedWordCount(cells.size());
+    for (size_t w = 0; w < wordCount; ++w)
+    {
+        words[w] = 0;
+    }
+    for (size_t i = 0; i < cells.size(); ++i)
+    {
+        if (cells[i])
+            words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+// Nagwek pliku binarnego z zapisem czasoprzestrzeni
+const char SPACETIME_MAGIC[8] = { 'C', 'A', '1', 'D', 'L', 'O', 'G', '1' };
+const int INITIAL_STATE_RULE = -1; // Znacznik wiersza ze stanem pocztkowym
+
+// Rejestrator czasoprzestrzeni: kady wiersz (sowo z regu i krokiem + komrki
+// spakowane bitowo) trafia do duego bufora w pamici. Peny bufor jest oddawany
+// wtkowi zapisujcemu, wic symulacja nie czeka na dysk.
+class SpacetimeRecorder
+{
+public:
+    SpacetimeRecorder(const string& filename, int cellCount, size_t bufferBytes = size_t(8) << 20)
+        : file(filename, ios::binary | ios::trunc), wordsPerRow(packedWordCount(cellCount))
+    {
+        if (!file.is_open())
+            throw runtime_error("Nie mozna otworzyc pliku: " + filename);
+
+        uint64_t header = static_cast<uint64_t>(cellCount);
+        file.write(SPACETIME_MAGIC, sizeof(SPACETIME_MAGIC));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        rowsPerBuffer = max<size_t>(1, bufferBytes / ((wordsPerRow + 1) * sizeof(uint64_t)));
+        active.reserve(rowsPerBuffer * (wordsPerRow + 1));
+        pending.reserve(rowsPerBuffer * (wordsPerRow + 1));
+        writer = thread(&SpacetimeRecorder::writerLoop, this);
+    }
+
+    ~SpacetimeRecorder()
+    {
+        close();
+    }
+
+    void record(const vector<int>& cells, int rule, int step)
+    {
+        size_t offset = active.size();
+        active.resize(offset + wordsPerRow + 1);
+        active[offset] = (uint64_t(uint32_t(rule)) << 32) | uint32_t(step);
+        packCells(cells, &active[offset + 1]);
+
+        if (active.size() >= rowsPerBuffer * (wordsPerRow + 1))
+            flush();
+    }
+
+    // Dopisuje reszt bufora i czeka na zakoczenie wtku zapisujcego
+    void close()
+    {
+        if (!writer.joinable())
+            return;
+
+        flush();
+        {
+            lock_guard<mutex> lock(m);
+            finished = true;
+        }
+        cv.notify_all();
+        writer.join();
+        file.close();
+    }
+
+private:
+    // Oddanie bufora wtkowi zapisujcemu (czeka tylko, jeli poprzedni jeszcze si zapisuje)
+    void flush()
+    {
+        if (active.empty())
+            return;
+
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this] { return pending.empty(); });
+        swap(active, pending);
+        lock.unlock();
+        cv.notify_all();
+    }
+
+    void writerLoop()
+    {
+        unique_lock<mutex> lock(m);
+        while (true)
+        {
+            cv.wait(lock, [this] { return !pending.empty() || finished; });
+            if (pending.empty())
+                return;
+
+            lock.unlock();
+            file.write(reinterpret_cast<const char*>(pending.data()), pending.size() * sizeof(uint64_t));
+            lock.lock();
+
+            pending.clear();
+            cv.notify_all();
+        }
+    }
+
     ofstream file;
-    file.open(filename, ios_base::app);
+    size_t wordsPerRow;
+    size_t rowsPerBuffer = 1;
+    vector<uint64_t> active;  // Bufor wypeniany przez symulacj
+    vector<uint64_t> pending; // Bufor zapisywany przez wtek w tle
+    mutex m;
+    condition_variable cv;
+    bool finished = false;
+    thread writer;
+};
+
+// Odczyt pliku z zapisem czasoprzestrzeni: wywouje funkcj dla kadego wiersza
+// i zwraca liczb komrek w wierszu
+int readSpacetimeLog(const string& filename, const function<void(int rule, int step, const vector<uint64_t>& words)>& onRow)
+{
+    ifstream file(filename, ios::binary);
+    if (!file.is_open())
+        throw runtime_error("Nie mozna otworzyc pliku: " + filename);
+
+    char magic[sizeof(SPACETIME_MAGIC)];
+    uint64_t cellCount = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&cellCount), sizeof(cellCount));
+    if (!file || !equal(magic, magic + sizeof(magic), SPACETIME_MAGIC))
+        throw runtime_error("Niepoprawny plik czasoprzestrzeni: " + filename);
 
-    if (file.is_open()) 
+    vector<uint64_t> words(packedWordCount(cellCount));
+    uint64_t rowHeader;
+    while (file.read(reinterpret_cast<char*>(&rowHeader), sizeof(rowHeader)))
     {
-        if (rule >= 100)
+        if (!file.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint64_t)))
+            throw runtime_error("Uciety plik czasoprzestrzeni: " + filename);
+
+        onRow(int32_t(rowHeader >> 32), int32_t(rowHeader & 0xFFFFFFFFu), words);
+    }
+    return static_cast<int>(cellCount);
+}
+
+// Liczba wierszy w pliku czasoprzestrzeni wyliczona z jego rozmiaru
+size_t spacetimeRowCount(const string& filename, int cellCount)
+{
+    ifstream file(filename, ios::binary | ios::ate);
+    size_t payload = static_cast<size_t>(file.tellg()) - sizeof(SPACETIME_MAGIC) - sizeof(uint64_t);
+    return payload / ((packedWordCount(cellCount) + 1) * sizeof(uint64_t));
+}
+
+int spacetimeCellCount(const string& filename)
+{
+    ifstream file(filename, ios::binary);
+    char magic[sizeof(SPACETIME_MAGIC)];
+    uint64_t cellCount = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&cellCount), sizeof(cellCount));
+    if (!file || !equal(magic, magic + sizeof(magic), SPACETIME_MAGIC))
+        throw runtime_error("Niepoprawny plik czasoprzestrzeni: " + filename);
+    return static_cast<int>(cellCount);
+}
+
+bool cellAt(const vector<uint64_t>& words, int i)
+{
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+// Odtworzenie dotychczasowego formatu tekstowego simulation_output.txt
+void renderLogToTXT(const string& logFile, const string& txtFile)
+{
+    ofstream file(txtFile, ios::out | ios::trunc);
+    if (!file.is_open())
+    {
+        cerr << "Bd otwarcia pliku: " << txtFile << endl;
+        return;
+    }
+
+    int cellCount = spacetimeCellCount(logFile);
+    string line;
+    readSpacetimeLog(logFile, [&](int rule, int step, const vector<uint64_t>& words)
+    {
+        line.clear();
+        if (rule == INITIAL_STATE_RULE)
         {
-            if(step <= 9)
-                file << "      Step " << step << ",  Rule " << rule << ": "; 
-            else
-                file << "      Step " << step << ", Rule " << rule << ": ";
+            line += "Poczatkowy stan komorek: ";
         }
         else
         {
-            if(step <= 9)
-                file << "      Step " << step << ",  Rule  " << rule << ": "; 
-            else
-                file << "      Step " << step << ", Rule  " << rule << ": "; 
+            line += "      Step " + to_string(step);
+            line += step <= 9 ? ",  Rule " : ", Rule ";
+            if (rule < 100)
+                line += ' ';
+            line += to_string(rule) + ": ";
         }
 
-        
-        for (size_t i = 0; i < cells.size(); ++i)
+        for (int i = 0; i < cellCount; ++i)
         {
-            file << setw(2) << (cells[i] ? '#' : '.'); 
-            if (i < cells.size() - 1) 
-                file << ' '; 
+            line += ' ';
+            line += cellAt(words, i) ? '#' : '.';
+            if (i < cellCount - 1)
+                line += ' ';
         }
-        file << endl; 
-        file.close();
+        line += '\n';
+        file << line;
+    });
+}
+
+// Czarno-biay obraz PBM (P4): jeden wiersz obrazu na krok czasowy, ywa komrka = czarny piksel
+void renderLogToPBM(const string& logFile, const string& pbmFile)
+{
+    ofstream file(pbmFile, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        cerr << "Bd otwarcia pliku: " << pbmFile << endl;
+        return;
     }
-    else 
-        cerr << "Bd otwarcia pliku: " << filename << endl;
+
+    int cellCount = spacetimeCellCount(logFile);
+    file << "P4\n" << cellCount << ' ' << spacetimeRowCount(logFile, cellCount) << '\n';
+
+    vector<uint8_t> row((cellCount + 7) / 8);
+    readSpacetimeLog(logFile, [&](int, int, const vector<uint64_t>& words)
+    {
+        fill(row.begin(), row.end(), 0);
+        for (int i = 0; i < cellCount; ++i)
+        {
+            if (cellAt(words, i))
+                row[i / 8] |= 0x80 >> (i % 8);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    });
 }
 
-void cleanTXT(string filename)
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size)
 {
-    ofstream file;
-    file.open(filename, ios::out | ios::trunc);
+    static uint32_t table[256] = {};
+    if (table[1] == 0)
+    {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
 }
 
-void runSimulation(int stepsPerRule, int cellCount, const vector<int>& rules) 
+void writeBigEndian32(vector<uint8_t>& out, uint32_t value)
 {
-    vector<int> cells(cellCount);
-    int ruleIndex = 0; 
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+void writePngChunk(ofstream& file, const char* type, const vector<uint8_t>& data)
+{
+    vector<uint8_t> chunk;
+    writeBigEndian32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    writeBigEndian32(chunk, crc32Update(0, chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
 
-    ofstream file("simulation_output.txt");
-    if (file.is_open()) 
+// Obraz PNG (1 bit na piksel, skala szaroci). Dane zapisywane s w nieskompresowanych
+// blokach deflate, dziki czemu nie potrzebujemy zewntrznej biblioteki
+void renderLogToPNG(const string& logFile, const string& pngFile)
+{
+    ofstream file(pngFile, ios::binary | ios::trunc);
+    if (!file.is_open())
     {
-        srand(static_cast<unsigned int>(time(0)));
-        file << "Poczatkowy stan komorek: ";
+        cerr << "Bd otwarcia pliku: " << pngFile << endl;
+        return;
+    }
+
+    int cellCount = spacetimeCellCount(logFile);
+    uint32_t height = static_cast<uint32_t>(spacetimeRowCount(logFile, cellCount));
+
+    // Surowe wiersze obrazu: bajt filtra (0) + piksele, bit 1 = biay
+    size_t rowBytes = (cellCount + 7) / 8;
+    vector<uint8_t> raw;
+    raw.reserve(height * (rowBytes + 1));
+    readSpacetimeLog(logFile, [&](int, int, const vector<uint64_t>& words)
+    {
+        raw.push_back(0);
+        size_t start = raw.size();
+        raw.resize(start + rowBytes, 0xFF);
         for (int i = 0; i < cellCount; ++i)
         {
-            cells[i] = rand() % 2; 
-            file << setw(2) << (cells[i] ? '#' : '.'); 
-            if (i < cellCount - 1) 
-                file << ' '; 
+            if (cellAt(words, i))
+                raw[start + i / 8] &= ~(0x80 >> (i % 8));
+        }
+    });
+
+    vector<uint8_t> header;
+    writeBigEndian32(header, static_cast<uint32_t>(cellCount));
+    writeBigEndian32(header, height);
+    header.push_back(1); // Gbia: 1 bit
+    header.push_back(0); // Skala szaroci
+    header.push_back(0); // Kompresja deflate
+    header.push_back(0); // Filtr standardowy
+    header.push_back(0); // Bez przeplotu
+
+    // Strumie zlib z blokami "stored" (maks. 65535 bajtw kady) i sum Adler-32
+    vector<uint8_t> zlib = { 0x78, 0x01 };
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = min<size_t>(65535, raw.size() - offset);
+        bool last = offset + blockSize == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(uint8_t(blockSize));
+        zlib.push_back(uint8_t(blockSize >> 8));
+        zlib.push_back(uint8_t(~blockSize));
+        zlib.push_back(uint8_t(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    writeBigEndian32(zlib, (b << 16) | a);
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    writePngChunk(file, "IHDR", header);
+    writePngChunk(file, "IDAT", zlib);
+    writePngChunk(file, "IEND", {});
+}
+
+// Ustawienia wyjcia symulacji
+struct OutputOptions
+{
+    bool console = true;                          // Wywietlanie krokw w terminalu
+    string logFile = "simulation_output.bin";     // Binarny zapis czasoprzestrzeni
+    string txtFile = "simulation_output.txt";     // Pusty = bez pliku tekstowego
+    string pbmFile;                               // Pusty = bez obrazu PBM
+    string pngFile;                               // Pusty = bez obrazu PNG
+};
+
+// Zamiana binarnego zapisu na wybrane formaty
+void renderSpacetimeLog(const OutputOptions& output)
+{
+    if (!output.txtFile.empty())
+        renderLogToTXT(output.logFile, output.txtFile);
+    if (!output.pbmFile.empty())
+        renderLogToPBM(output.logFile, output.pbmFile);
+    if (!output.pngFile.empty())
+        renderLogToPNG(output.logFile, output.pngFile);
+}
+
+// Warunki brzegowe dla silnika na wierszach spakowanych bitowo
+enum class Boundary { Fixed, Periodic, Absorptive };
+
+Boundary parseBoundary(const string& name)
+{
+    if (name == "fixed")
+        return Boundary::Fixed;
+    if (name == "periodic")
+        return Boundary::Periodic;
+    if (name == "absorptive")
+        return Boundary::Absorptive;
+    throw invalid_argument("Nieznany warunek brzegowy: " + name);
+}
+
+// Regua zastosowana do 64 komrek naraz. Wzorzec (l, c, r) o indeksie p daje
+// bit (7 - p) numeru reguy - tak samo jak ruleToBinary i applyRule
+uint64_t applyRulePacked(int rule, uint64_t left, uint64_t center, uint64_t right)
+{
+    uint64_t result = 0;
+    for (int p = 0; p < 8; ++p)
+    {
+        if ((rule >> (7 - p)) & 1)
+        {
+            result |= ((p & 4) ? left : ~left) & ((p & 2) ? center : ~center) & ((p & 1) ? right : ~right);
+        }
+    }
+    return result;
+}
+
+// Jeden krok automatu na wierszu spakowanym bitowo. Daje te same wyniki co
+// updateCells / updateCellsPeriodic / updateCellsAbsorptive
+void stepPacked(const vector<uint64_t>& in, vector<uint64_t>& out, int cellCount, int rule, Boundary boundary)
+{
+    size_t last = in.size() - 1;
+    int lastBit = (cellCount - 1) % 64;
+    uint64_t lastMask = lastBit == 63 ? ~uint64_t(0) : (uint64_t(1) << (lastBit + 1)) - 1;
+    uint64_t firstCell = in[0] & 1;
+    uint64_t lastCell = (in[last] >> lastBit) & 1;
+
+    for (size_t w = 0; w <= last; ++w)
+    {
+        uint64_t center = in[w];
+        uint64_t left = (center << 1) | (w > 0 ? in[w - 1] >> 63 : 0);
+        uint64_t right = (center >> 1) | (w < last ? in[w + 1] << 63 : 0);
+        if (boundary == Boundary::Periodic)
+        {
+            if (w == 0)
+                left |= lastCell;
+            if (w == last)
+                right |= firstCell << lastBit;
+        }
+        out[w] = applyRulePacked(rule, left, center, right);
+    }
+    out[last] &= lastMask;
+
+    if (boundary == Boundary::Fixed)
+    {
+        // Zachowanie pierwszej i ostatniej komrki
+        out[0] = (out[0] & ~uint64_t(1)) | firstCell;
+        out[last] = (out[last] & ~(uint64_t(1) << lastBit)) | (lastCell << lastBit);
+    }
+}
+
+size_t popcount64(uint64_t word)
+{
+    return bitset<64>(word).count();
+}
+
+size_t packedPopulation(const vector<uint64_t>& words)
+{
+    size_t population = 0;
+    for (uint64_t word : words)
+        population += popcount64(word);
+    return population;
+}
+
+size_t packedHammingDistance(const vector<uint64_t>& a, const vector<uint64_t>& b)
+{
+    size_t distance = 0;
+    for (size_t w = 0; w < a.size(); ++w)
+        distance += popcount64(a[w] ^ b[w]);
+    return distance;
+}
+
+// 64-bitowy skrt spakowanego wiersza (mieszanie kolejnych sw jak w splitmix64)
+uint64_t hashPacked(const vector<uint64_t>& words)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (uint64_t word : words)
+    {
+        hash ^= word + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+// Entropia Shannona blokw dugoci blockLength (z zawiniciem), znormalizowana do [0, 1]
+double blockEntropy(const vector<uint64_t>& words, int cellCount, int blockLength)
+{
+    vector<size_t> counts(size_t(1) << blockLength, 0);
+    for (int i = 0; i < cellCount; ++i)
+    {
+        size_t pattern = 0;
+        for (int k = 0; k < blockLength; ++k)
+            pattern = (pattern << 1) | cellAt(words, (i + k) % cellCount);
+        ++counts[pattern];
+    }
+
+    double entropy = 0.0;
+    for (size_t count : counts)
+    {
+        if (count > 0)
+        {
+            double p = static_cast<double>(count) / cellCount;
+            entropy -= p * log2(p);
         }
-        file << endl;
     }
-    cout << endl << "Poczatkowy stan komorek" << endl;
-    displayCells(cells);
+    return entropy / blockLength;
+}
 
+// Wykrywanie cyklu algorytmem Brenta. Kolejne stany podawane s po kadym kroku;
+// stany porwnywane s najpierw po 64-bitowym skrcie, a przy zgodnoci skrtw
+// dokadnie, wic kolizja skrtu nie da faszywego cyklu
+class CycleDetector
+{
+public:
+    explicit CycleDetector(const vector<uint64_t>& start)
+        : tortoise(start), tortoiseHash(hashPacked(start))
+    {
+    }
 
-    for (int ruleStep = 0; ruleStep < rules.size(); ++ruleStep) 
+    // Zwraca true, gdy stan po kolejnym kroku zamyka cykl
+    bool feed(const vector<uint64_t>& state)
+    {
+        if (cycleFound)
+            return true;
+
+        ++lambda;
+        uint64_t hash = hashPacked(state);
+        if (hash == tortoiseHash && state == tortoise)
+        {
+            cycleFound = true;
+            return true;
+        }
+
+        if (lambda == power)
+        {
+            tortoise = state;
+            tortoiseHash = hash;
+            power *= 2;
+            lambda = 0;
+        }
+        return false;
+    }
+
+    bool found() const { return cycleFound; }
+    int period() const { return lambda; }
+
+private:
+    vector<uint64_t> tortoise;
+    uint64_t tortoiseHash;
+    int power = 1;
+    int lambda = 0;
+    bool cycleFound = false;
+};
+
+// Dugo fazy przejciowej: liczba krokw od stanu start do pierwszego stanu w cyklu
+int findTransient(const vector<uint64_t>& start, int cellCount, int rule, Boundary boundary, int period)
+{
+    vector<uint64_t> tortoise = start, hare = start, next(start.size());
+    for (int i = 0; i < period; ++i)
+    {
+        stepPacked(hare, next, cellCount, rule, boundary);
+        swap(hare, next);
+    }
+
+    int transient = 0;
+    while (tortoise != hare)
+    {
+        stepPacked(tortoise, next, cellCount, rule, boundary);
+        swap(tortoise, next);
+        stepPacked(hare, next, cellCount, rule, boundary);
+        swap(hare, next);
+        ++transient;
+    }
+    return transient;
+}
+
+// Co zrobi po wykryciu cyklu w runSimulation
+enum class CycleMode { Off, Stop, Skip };
+
+CycleMode parseCycleMode(const string& name)
+{
+    if (name == "off")
+        return CycleMode::Off;
+    if (name == "stop")
+        return CycleMode::Stop;
+    if (name == "skip")
+        return CycleMode::Skip;
+    throw invalid_argument("Nieznany tryb cykli: " + name);
+}
+
+void runSimulation(int stepsPerRule, int cellCount, const vector<int>& rules, const OutputOptions& output,
+    uint64_t seed, CycleMode cycleMode = CycleMode::Off)
+{
+    vector<int> cells(cellCount);
+    SpacetimeRecorder recorder(output.logFile, cellCount);
+
+    parallelFillBernoulli(cells.data(), cells.size(), 0.5, CounterRng(seed));
+    recorder.record(cells, INITIAL_STATE_RULE, 0);
+
+    if (output.console)
+    {
+        cout << endl << "Poczatkowy stan komorek" << endl;
+        displayCells(cells);
+    }
+
+    vector<uint64_t> packed(packedWordCount(cellCount));
+    for (int ruleStep = 0; ruleStep < rules.size(); ++ruleStep)
     {
         int currentRule = rules[ruleStep];
-        vector<int> binaryRule = ruleToBinary(currentRule); 
-        cout << endl << "Wykonywanie reguly: " << currentRule << endl;
+        vector<int> binaryRule = ruleToBinary(currentRule);
+        if (output.console)
+            cout << endl << "Wykonywanie reguly: " << currentRule << endl;
+
+        packCells(cells, packed.data());
+        vector<uint64_t> ruleStart = packed;
+        CycleDetector detector(ruleStart);
+
+        // Bufory automatu przydzielane s raz na regu, a nie w kadym kroku
+        Automaton1D<1, 2, RuleKind::Full, FixedBoundary> automaton(cellCount, elementaryRuleTable(binaryRule));
+        automaton.load(cells);
+
         for (int step = 0; step < stepsPerRule; ++step)
         {
-            displayCells(cells);
-            saveToTXT(cells, step, "simulation_output.txt", currentRule);
-            //if (step == stepsPerRule - 1)
-              //  saveToTXT(cells, step, "simulation_output.txt", currentRule);
-            updateCells(cells, binaryRule);     //WARUNKI BRZEGOWE
+            if (output.console)
+                displayCells(cells);
+            recorder.record(cells, currentRule, step);
+            automaton.step();     //WARUNKI BRZEGOWE
+            automaton.store(cells);
+
+            if (cycleMode != CycleMode::Off && !detector.found())
+            {
+                packCells(cells, packed.data());
+                if (detector.feed(packed))
+                {
+                    int period = detector.period();
+                    int transient = findTransient(ruleStart, cellCount, currentRule, Boundary::Fixed, period);
+                    cout << "Regula " << currentRule << ": cykl po " << transient << " krokach, okres " << period << endl;
+
+                    if (cycleMode == CycleMode::Stop)
+                        break;
+
+                    // Pominicie penych okresw - stan kocowy jest taki sam jak bez pomijania
+                    // (ostatni okres jest wykonywany, eby zapis koczy si na ostatnim kroku)
+                    int remaining = stepsPerRule - (step + 1);
+                    step += (remaining - 1) / period * period;
+                }
+            }
+        }
+    }
+    recorder.close();
+}
+
+// Ustawienia przegldu regu
+struct SweepOptions
+{
+    vector<int> rules;                    // Puste = wszystkie 256 regu
+    int cellCount = 256;
+    int steps = 1024;
+    int trials = 64;                      // Liczba losowych stanw pocztkowych na regu
+    unsigned threads = 0;                 // 0 = wszystkie rdzenie
+    uint64_t seed = 2024;
+    Boundary boundary = Boundary::Periodic;
+    string outFile = "sweep_output.txt";
+};
+
+// Wynik jednego przebiegu (regua + stan pocztkowy)
+struct TrialResult
+{
+    double density = 0.0;    // Gsto ywych komrek w ostatnim kroku
+    double entropy = 0.0;    // Entropia blokw w ostatnim kroku
+    double damage = 0.0;     // Odlego Hamminga kopii z jedn odwrcon komrk / liczba komrek
+    double lyapunov = 0.0;   // ln(uszkodzenie) / kroki, gdy uszkodzenie przetrwao
+    bool damageSurvived = false;
+    bool cycled = false;     // Czy wykryto cykl w zadanej liczbie krokw
+    int transient = 0;
+    int period = 0;
+};
+
+const int ENTROPY_BLOCK_LENGTH = 4;
+
+TrialResult runTrial(int rule, int trial, const SweepOptions& options)
+{
+    int n = options.cellCount;
+    size_t wordCount = packedWordCount(n);
+
+    // Strumie zaley tylko od (regua, prba), wic wynik nie zaley od liczby wtkw
+    vector<int> cells(n);
+    fillBernoulli(cells.data(), cells.size(), 0.5, CounterRng(options.seed), 0, (uint64_t(rule) << 32) | uint32_t(trial));
+
+    vector<uint64_t> row(wordCount), next(wordCount);
+    packCells(cells, row.data());
+    vector<uint64_t> damaged = row, damagedNext(wordCount);
+    damaged[(n / 2) / 64] ^= uint64_t(1) << ((n / 2) % 64);
+
+    // Odwiedzone stany: skrt -> krok oraz same wiersze (history, wordCount sw na krok), eby
+    // przy zgodnoci skrtw porwna wiersze dokadnie - kolizja skrtu nie da faszywego cyklu
+    TrialResult result;
+    unordered_multimap<uint64_t, int> seen;
+    vector<uint64_t> history = row;
+    seen.emplace(hashPacked(row), 0);
+
+    for (int step = 1; step <= options.steps; ++step)
+    {
+        stepPacked(row, next, n, rule, options.boundary);
+        stepPacked(damaged, damagedNext, n, rule, options.boundary);
+        swap(row, next);
+        swap(damaged, damagedNext);
+
+        if (!result.cycled)
+        {
+            uint64_t hash = hashPacked(row);
+            auto candidates = seen.equal_range(hash);
+            for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+            {
+                if (equal(row.begin(), row.end(), history.begin() + size_t(candidate->second) * wordCount))
+                {
+                    result.cycled = true;
+                    result.transient = candidate->second;
+                    result.period = step - candidate->second;
+                    break;
+                }
+            }
+
+            if (result.cycled)
+            {
+                seen.clear();
+                vector<uint64_t>().swap(history);
+            }
+            else
+            {
+                seen.emplace(hash, step);
+                history.insert(history.end(), row.begin(), row.end());
+            }
+        }
+    }
+
+    size_t distance = packedHammingDistance(row, damaged);
+    result.density = static_cast<double>(packedPopulation(row)) / n;
+    result.entropy = blockEntropy(row, n, ENTROPY_BLOCK_LENGTH);
+    result.damage = static_cast<double>(distance) / n;
+    result.damageSurvived = distance > 0;
+    if (result.damageSurvived)
+        result.lyapunov = log(static_cast<double>(distance)) / options.steps;
+    return result;
+}
+
+// Przegld regu: kada para (regua, prba) to osobne zadanie; wtki pobieraj
+// kolejne zadania z licznika atomowego, a wyniki trafiaj do osobnych komrek tablicy
+void runSweep(const SweepOptions& options)
+{
+    vector<int> rules = options.rules;
+    if (rules.empty())
+    {
+        for (int rule = 0; rule < 256; ++rule)
+            rules.push_back(rule);
+    }
+    for (int rule : rules)
+        ruleToBinary(rule); // Walidacja zakresu
+
+    size_t trials = static_cast<size_t>(options.trials);
+    size_t taskCount = rules.size() * trials;
+    vector<TrialResult> results(taskCount);
+    atomic<size_t> nextTask(0);
+
+    unsigned threadCount = options.threads ? options.threads : max(1u, thread::hardware_concurrency());
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t task = nextTask++; task < taskCount; task = nextTask++)
+            {
+                results[task] = runTrial(rules[task / trials], static_cast<int>(task % trials), options);
+            }
+        });
+    }
+    for (thread& worker : workers)
+        worker.join();
+
+    ofstream file(options.outFile, ios::out | ios::trunc);
+    if (!file.is_open())
+        throw runtime_error("Nie mozna otworzyc pliku: " + options.outFile);
+
+    file << "# komorki " << options.cellCount << ", kroki " << options.steps << ", proby " << options.trials
+        << ", ziarno " << options.seed << endl;
+    file << setw(5) << "rule" << setw(10) << "density" << setw(10) << "entropy" << setw(10) << "damage"
+        << setw(10) << "lyapunov" << setw(11) << "transient" << setw(10) << "period" << setw(8) << "cycled" << endl;
+    file << fixed << setprecision(4);
+
+    for (size_t r = 0; r < rules.size(); ++r)
+    {
+        double density = 0, entropy = 0, damage = 0, lyapunov = 0, transient = 0, period = 0;
+        int survived = 0, cycled = 0;
+        for (size_t t = 0; t < trials; ++t)
+        {
+            const TrialResult& trial = results[r * trials + t];
+            density += trial.density;
+            entropy += trial.entropy;
+            damage += trial.damage;
+            if (trial.damageSurvived)
+            {
+                lyapunov += trial.lyapunov;
+                ++survived;
+            }
+            if (trial.cycled)
+            {
+                transient += trial.transient;
+                period += trial.period;
+                ++cycled;
+            }
+        }
+
+        file << setw(5) << rules[r] << setw(10) << density / trials << setw(10) << entropy / trials
+            << setw(10) << damage / trials;
+        if (survived > 0)
+            file << setw(10) << lyapunov / survived;
+        else
+            file << setw(10) << "-";
+        if (cycled > 0)
+            file << setw(11) << setprecision(1) << transient / cycled << setw(10) << period / cycled << setprecision(4);
+        else
+            file << setw(11) << "-" << setw(10) << "-";
+        file << setw(8) << static_cast<double>(cycled) / trials << endl;
+    }
+
+    cout << "Przeglad " << rules.size() << " regul (" << taskCount << " przebiegow, " << threadCount
+        << " watkow) zapisany do " << options.outFile << endl;
+}
+
+// Silnik HashLife dla automatu 1D z periodycznym warunkiem brzegowym.
+// Wze poziomu k opisuje 2^k kolejnych komrek; licie (poziom 5) przechowuj
+// 32 komrki w bitach, a wzy wewntrzne s kanonizowane w tablicy haszujcej,
+// wic identyczne fragmenty wiersza maj ten sam identyfikator. Wynik wza
+// poziomu k to jego rodkowe 2^(k-1) komrek po 2^(k-2) krokach - liczony raz
+// i zapamitywany, dziki czemu powtarzajce si struktury przeskakuj w czasie.
+class HashLife1D
+{
+public:
+    HashLife1D(int rule, size_t memoryBudgetBytes = size_t(256) << 20)
+        : rule(rule), maxNodes(max<size_t>(1024, memoryBudgetBytes / BYTES_PER_NODE))
+    {
+        ruleToBinary(rule); // Walidacja zakresu
+    }
+
+    // Przesunicie wiersza o zadan liczb krokw. Liczba komrek musi by potg
+    // dwjki (co najmniej 64)
+    vector<uint64_t> advance(const vector<uint64_t>& row, int cellCount, uint64_t generations)
+    {
+        if (cellCount < 64 || (cellCount & (cellCount - 1)) != 0)
+            throw invalid_argument("HashLife wymaga liczby komorek bedacej potega dwojki (min. 64)");
+
+        int level = 0;
+        while ((1 << level) < cellCount)
+            ++level;
+
+        uint32_t root = buildRow(row, 0, level);
+
+        // Pene przeskoki o 2^(level-1) krokw skadane binarnie z zapamitanych podwoje
+        uint64_t fullJumps = generations >> (level - 1);
+        for (int e = 0; fullJumps != 0; ++e, fullJumps >>= 1)
+        {
+            if (fullJumps & 1)
+                root = jumpFull(root, e);
+        }
+
+        // Pozostae kroki: przeskoki o 2^j dla kolejnych bitw, a kocwka bezporednio
+        for (int j = level - 2; j >= LEAF_LEVEL; --j)
+        {
+            if ((generations >> j) & 1)
+            {
+                root = advanceSpan(root, root, root, j);
+                root = collectIfOverBudget(root);
+            }
         }
+
+        vector<uint64_t> result(row.size());
+        unpackRow(root, result, 0);
+
+        vector<uint64_t> next(result.size());
+        uint64_t remainder = generations & ((uint64_t(1) << LEAF_LEVEL) - 1);
+        for (uint64_t step = 0; step < remainder; ++step)
+        {
+            stepPacked(result, next, cellCount, rule, Boundary::Periodic);
+            swap(result, next);
+        }
+        return result;
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t collections() const { return collectionCount; }
+
+private:
+    static const int LEAF_LEVEL = 5;                 // Li = 32 komrki
+    static const uint32_t NO_NODE = 0xFFFFFFFFu;
+    static const size_t BYTES_PER_NODE = 96;         // Wze + wpisy w tablicach haszujcych (szacunkowo)
+
+    struct Node
+    {
+        uint64_t bits;    // Komrki licia
+        uint32_t left;
+        uint32_t right;
+        uint32_t result;  // Zapamitany wynik albo NO_NODE
+        int level;
+    };
+
+    uint32_t leaf(uint64_t bits)
+    {
+        auto found = leaves.find(bits);
+        if (found != leaves.end())
+            return found->second;
+
+        nodes.push_back({ bits, NO_NODE, NO_NODE, NO_NODE, LEAF_LEVEL });
+        uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+        leaves.emplace(bits, id);
+        return id;
+    }
+
+    uint32_t join(uint32_t left, uint32_t right)
+    {
+        uint64_t key = (uint64_t(left) << 32) | right;
+        auto found = joins.find(key);
+        if (found != joins.end())
+            return found->second;
+
+        nodes.push_back({ 0, left, right, NO_NODE, nodes[left].level + 1 });
+        uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+        joins.emplace(key, id);
+        return id;
+    }
+
+    // rodkowe 2^(k-1) komrek wza poziomu k po 2^(k-2) krokach
+    uint32_t result(uint32_t id)
+    {
+        if (nodes[id].result != NO_NODE)
+            return nodes[id].result;
+
+        uint32_t computed;
+        if (nodes[id].level == LEAF_LEVEL + 1)
+        {
+            // 64 komrki krok po kroku; stoek wiata zawa poprawny obszar do rodka
+            uint64_t cells = nodes[nodes[id].left].bits | (nodes[nodes[id].right].bits << 32);
+            for (int step = 0; step < 16; ++step)
+                cells = applyRulePacked(rule, cells << 1, cells, cells >> 1);
+            computed = leaf((cells >> 16) & 0xFFFFFFFFu);
+        }
+        else
+        {
+            uint32_t a = nodes[id].left;
+            uint32_t b = nodes[id].right;
+            uint32_t r0 = result(a);
+            uint32_t r1 = result(join(nodes[a].right, nodes[b].left));
+            uint32_t r2 = result(b);
+            computed = join(result(join(r0, r1)), result(join(r1, r2)));
+        }
+
+        nodes[id].result = computed;
+        return computed;
+    }
+
+    // Wze center (z ssiadami tego samego poziomu) po 2^j krokach
+    uint32_t advanceSpan(uint32_t left, uint32_t center, uint32_t right, int j)
+    {
+        uint32_t span = join(join(nodes[left].right, nodes[center].left), join(nodes[center].right, nodes[right].left));
+        if (nodes[center].level == j + 1)
+            return result(span);
+
+        uint64_t key = (uint64_t(span) << 8) | uint64_t(j);
+        auto found = spanMemo.find(key);
+        if (found != spanMemo.end())
+            return found->second;
+
+        uint32_t a = nodes[center].left;
+        uint32_t b = nodes[center].right;
+        uint32_t advanced = join(advanceSpan(nodes[left].right, a, b, j), advanceSpan(a, b, nodes[right].left, j));
+        spanMemo.emplace(key, advanced);
+        return advanced;
+    }
+
+    // Cay wiersz (periodyczny) po 2^e penych przeskokach o 2^(poziom-1) krokw. Budet
+    // pamici jest sprawdzany po kadym pojedynczym przeskoku, wic tablica wzw nie ronie
+    // ponad niego o wicej ni jeden przeskok; jedynym ywym wzem jest wtedy biecy wiersz
+    uint32_t jumpFull(uint32_t root, int e)
+    {
+        if (e == 0)
+            return collectIfOverBudget(advanceSpan(root, root, root, nodes[root].level - 1));
+
+        uint64_t key = (uint64_t(root) << 8) | uint64_t(e);
+        auto found = jumpMemo.find(key);
+        if (found != jumpMemo.end())
+            return found->second;
+
+        // Po czyszczeniu w trakcie przeskoku identyfikator root jest nieaktualny - bez zapamitania
+        size_t collectionsBefore = collectionCount;
+        uint32_t jumped = jumpFull(jumpFull(root, e - 1), e - 1);
+        if (collectionCount == collectionsBefore)
+            jumpMemo.emplace(key, jumped);
+        return jumped;
+    }
+
+    uint32_t buildRow(const vector<uint64_t>& row, size_t firstCell, int level)
+    {
+        if (level == LEAF_LEVEL)
+            return leaf((row[firstCell / 64] >> (firstCell % 64)) & 0xFFFFFFFFu);
+
+        size_t half = size_t(1) << (level - 1);
+        return join(buildRow(row, firstCell, level - 1), buildRow(row, firstCell + half, level - 1));
+    }
+
+    void unpackRow(uint32_t id, vector<uint64_t>& row, size_t firstCell) const
+    {
+        if (nodes[id].level == LEAF_LEVEL)
+        {
+            row[firstCell / 64] |= nodes[id].bits << (firstCell % 64);
+            return;
+        }
+
+        unpackRow(nodes[id].left, row, firstCell);
+        unpackRow(nodes[id].right, row, firstCell + (size_t(1) << (nodes[id].level - 1)));
+    }
+
+    // Po przekroczeniu budetu pamici zostaje tylko drzewo biecego wiersza,
+    // a wszystkie zapamitane wyniki s usuwane
+    uint32_t collectIfOverBudget(uint32_t root)
+    {
+        if (nodes.size() <= maxNodes)
+            return root;
+
+        vector<Node> oldNodes;
+        oldNodes.swap(nodes);
+        leaves.clear();
+        joins.clear();
+        spanMemo.clear();
+        jumpMemo.clear();
+        ++collectionCount;
+        return copyTree(oldNodes, root);
+    }
+
+    uint32_t copyTree(const vector<Node>& oldNodes, uint32_t id)
+    {
+        if (oldNodes[id].level == LEAF_LEVEL)
+            return leaf(oldNodes[id].bits);
+        return join(copyTree(oldNodes, oldNodes[id].left), copyTree(oldNodes, oldNodes[id].right));
+    }
+
+    int rule;
+    size_t maxNodes;
+    size_t collectionCount = 0;
+    vector<Node> nodes;
+    unordered_map<uint64_t, uint32_t> leaves;
+    unordered_map<uint64_t, uint32_t> joins;
+    unordered_map<uint64_t, uint32_t> spanMemo;
+    unordered_map<uint64_t, uint32_t> jumpMemo;
+};
+
+// Ustawienia dugich przebiegw (HashLife i blokowanie czasowe)
+struct LongRunOptions
+{
+    uint64_t generations = 1000000;
+    size_t memoryBudgetMB = 256;          // Budet pamici HashLife
+    size_t tileWidth = 4096;              // Szeroko kafelka przy blokowaniu czasowym
+    int blockSteps = 32;                  // Pokolenia liczone naraz w jednym kafelku
+    bool verify = false;                  // Porwnanie z silnikiem bezporednim
+};
+
+// Dugi przebieg dla kadej z regu (wsplne --cells, --rules, --seed z przegldem)
+void runHashLife(const SweepOptions& sweepOptions, const LongRunOptions& options)
+{
+    vector<int> rules = sweepOptions.rules.empty() ? vector<int>{ 190, 26 } : sweepOptions.rules;
+    int n = sweepOptions.cellCount;
+
+    vector<int> cells(n);
+    parallelFillBernoulli(cells.data(), cells.size(), 0.5, CounterRng(sweepOptions.seed));
+    vector<uint64_t> initial(packedWordCount(n));
+    packCells(cells, initial.data());
+
+    for (int rule : rules)
+    {
+        HashLife1D engine(rule, options.memoryBudgetMB << 20);
+
+        auto start = chrono::steady_clock::now();
+        vector<uint64_t> row = engine.advance(initial, n, options.generations);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << "Regula " << rule << ": " << options.generations << " krokow w " << seconds << " s, gestosc "
+            << static_cast<double>(packedPopulation(row)) / n << ", wezly " << engine.nodeCount()
+            << ", czyszczenia pamieci " << engine.collections() << endl;
+
+        if (options.verify)
+        {
+            vector<uint64_t> direct = initial, next(direct.size());
+            for (uint64_t step = 0; step < options.generations; ++step)
+            {
+                stepPacked(direct, next, n, rule, Boundary::Periodic);
+                swap(direct, next);
+            }
+            if (direct != row)
+                throw runtime_error("HashLife i silnik bezposredni daja rozne wyniki dla reguly " + to_string(rule));
+            cout << "  zgodne z silnikiem bezposrednim" << endl;
+        }
+    }
+}
+
+template <template <int> class BoundaryPolicy>
+void runBlockedWith(const LongRunOptions& options, int rule, const vector<int>& initial)
+{
+    ElementaryRuleTable table = elementaryRuleTable(rule);
+    BlockedStepper1D<1, 2, RuleKind::Full, BoundaryPolicy> stepper(initial.size(), table, options.tileWidth, options.blockSteps);
+    stepper.load(initial);
+
+    auto start = chrono::steady_clock::now();
+    stepper.advance(options.generations);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<int> cells(initial.size());
+    stepper.store(cells);
+    size_t population = count(cells.begin(), cells.end(), 1);
+    cout << "Regula " << rule << ": " << options.generations << " krokow w " << seconds << " s ("
+        << double(initial.size()) * double(options.generations) / seconds << " komorek/s), gestosc "
+        << static_cast<double>(population) / cells.size() << endl;
+
+    if (options.verify)
+    {
+        Automaton1D<1, 2, RuleKind::Full, BoundaryPolicy> automaton(initial.size(), table);
+        automaton.load(initial);
+        for (uint64_t step = 0; step < options.generations; ++step)
+            automaton.step();
+        if (!equal(automaton.cells(), automaton.cells() + initial.size(), stepper.cells()))
+            throw runtime_error("Blokowanie czasowe i silnik bezposredni daja rozne wyniki dla reguly " + to_string(rule));
+        cout << "  zgodne z silnikiem bezposrednim" << endl;
     }
 }
 
-int main() {
-    int steps = 21; 
-    int cellCount = 31;    
+// Dugi przebieg z blokowaniem czasowym (dowolna liczba komrek i warunek brzegowy)
+void runBlocked(const SweepOptions& sweepOptions, const LongRunOptions& options)
+{
+    vector<int> rules = sweepOptions.rules.empty() ? vector<int>{ 190, 26 } : sweepOptions.rules;
+
+    vector<int> initial(sweepOptions.cellCount);
+    parallelFillBernoulli(initial.data(), initial.size(), 0.5, CounterRng(sweepOptions.seed));
 
-    cout << "Podaj liczbe komorek: ";
-    cin >> cellCount;
-    cout << "Podaj liczbe iteracji: ";
-    cin >> steps;
+    for (int rule : rules)
+    {
+        ruleToBinary(rule); // Walidacja zakresu
+        switch (sweepOptions.boundary)
+        {
+        case Boundary::Fixed:
+            runBlockedWith<FixedBoundary>(options, rule, initial);
+            break;
+        case Boundary::Periodic:
+            runBlockedWith<PeriodicBoundary>(options, rule, initial);
+            break;
+        case Boundary::Absorptive:
+            runBlockedWith<AbsorptiveBoundary>(options, rule, initial);
+            break;
+        }
+    }
+}
 
-    if (cellCount <= 0 || steps <= 0) 
+vector<int> parseRuleList(const string& text)
+{
+    vector<int> rules;
+    size_t start = 0;
+    while (start <= text.size())
     {
-        cerr << "Liczba komorek i krokow musi byc wieksza od 0" << endl;
-        return 1; 
+        size_t end = text.find(',', start);
+        if (end == string::npos)
+            end = text.size();
+        rules.push_back(stoi(text.substr(start, end - start)));
+        start = end + 1;
     }
+    return rules;
+}
 
-    vector<int> rules = { 40, 63, 26, 190 }; 
-    cleanTXT("simulation_output.txt");
+int main(int argc, char* argv[]) {
+    int steps = 21;
+    int cellCount = 31;
+    OutputOptions output;
+    bool renderOnly = false;
+    CycleMode cycleMode = CycleMode::Off;
+    bool sweep = false;
+    SweepOptions sweepOptions;
+    bool seedGiven = false;
+    bool hashLife = false;
+    bool blocked = false;
+    LongRunOptions longRunOptions;
 
-    try 
+    try
     {
-        runSimulation(steps, cellCount, rules);
+        // Opcje: --quiet (bez wywietlania w terminalu), --pbm, --png (dodatkowe obrazy),
+        // --seed (ziarno losowego stanu pocztkowego; take dla przegldu i dugich przebiegw),
+        // --cycles off|stop|skip (wykrywanie cykli: zatrzymanie reguy lub pominicie penych okresw),
+        // --render <plik.bin> (tylko zamiana istniejcego zapisu na formaty wyjciowe),
+        // --sweep (przegld regu) z --rules, --cells, --steps, --trials, --threads, --seed,
+        // --boundary, --out, --hashlife (dugi przebieg) z --generations, --memory, --verify,
+        // --blocked (dugi przebieg z blokowaniem czasowym) z --tile, --block-steps
+        for (int i = 1; i < argc; ++i)
+        {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--quiet")
+                output.console = false;
+            else if (arg == "--pbm")
+                output.pbmFile = "simulation_output.pbm";
+            else if (arg == "--png")
+                output.pngFile = "simulation_output.png";
+            else if (arg == "--cycles" && hasValue)
+                cycleMode = parseCycleMode(argv[++i]);
+            else if (arg == "--render" && hasValue)
+            {
+                output.logFile = argv[++i];
+                renderOnly = true;
+            }
+            else if (arg == "--sweep")
+                sweep = true;
+            else if (arg == "--rules" && hasValue)
+                sweepOptions.rules = parseRuleList(argv[++i]);
+            else if (arg == "--cells" && hasValue)
+                sweepOptions.cellCount = stoi(argv[++i]);
+            else if (arg == "--steps" && hasValue)
+                sweepOptions.steps = stoi(argv[++i]);
+            else if (arg == "--trials" && hasValue)
+                sweepOptions.trials = stoi(argv[++i]);
+            else if (arg == "--threads" && hasValue)
+                sweepOptions.threads = static_cast<unsigned>(stoul(argv[++i]));
+            else if (arg == "--seed" && hasValue)
+            {
+                sweepOptions.seed = stoull(argv[++i]);
+                seedGiven = true;
+            }
+            else if (arg == "--boundary" && hasValue)
+                sweepOptions.boundary = parseBoundary(argv[++i]);
+            else if (arg == "--out" && hasValue)
+                sweepOptions.outFile = argv[++i];
+            else if (arg == "--hashlife")
+                hashLife = true;
+            else if (arg == "--generations" && hasValue)
+                longRunOptions.generations = stoull(argv[++i]);
+            else if (arg == "--memory" && hasValue)
+                longRunOptions.memoryBudgetMB = stoul(argv[++i]);
+            else if (arg == "--blocked")
+                blocked = true;
+            else if (arg == "--tile" && hasValue)
+                longRunOptions.tileWidth = stoul(argv[++i]);
+            else if (arg == "--block-steps" && hasValue)
+                longRunOptions.blockSteps = stoi(argv[++i]);
+            else if (arg == "--verify")
+                longRunOptions.verify = true;
+            else
+            {
+                cerr << "Nieznana opcja: " << arg << endl;
+                return 1;
+            }
+        }
+
+        if (sweep)
+        {
+            if (sweepOptions.cellCount <= 0 || sweepOptions.steps <= 0 || sweepOptions.trials <= 0)
+            {
+                cerr << "Liczba komorek, krokow i prob musi byc wieksza od 0" << endl;
+                return 1;
+            }
+            runSweep(sweepOptions);
+            return 0;
+        }
+
+        if (hashLife)
+        {
+            runHashLife(sweepOptions, longRunOptions);
+            return 0;
+        }
+
+        if (blocked)
+        {
+            runBlocked(sweepOptions, longRunOptions);
+            return 0;
+        }
+
+        if (!renderOnly)
+        {
+            cout << "Podaj liczbe komorek: ";
+            cin >> cellCount;
+            cout << "Podaj liczbe iteracji: ";
+            cin >> steps;
+
+            if (cellCount <= 0 || steps <= 0)
+            {
+                cerr << "Liczba komorek i krokow musi byc wieksza od 0" << endl;
+                return 1;
+            }
+
+            // Bez --seed ziarno pochodzi z zegara; wypisujemy je, eby przebieg dao si powtrzy
+            uint64_t seed = seedGiven ? sweepOptions.seed : static_cast<uint64_t>(time(0));
+            cout << "Ziarno: " << seed << endl;
+
+            vector<int> rules = { 40, 63, 26, 190 };
+            runSimulation(steps, cellCount, rules, output, seed, cycleMode);
+        }
+        renderSpacetimeLog(output);
     }
-    catch (const exception& e) 
+    catch (const exception& e)
     {
-        cerr << "Wystapil blad: " << e.what() << endl; 
-        return 1; 
+        cerr << "Wystapil blad: " << e.what() << endl;
+        return 1;
     }
 
     return 0;
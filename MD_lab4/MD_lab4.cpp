@@ -3,6 +3,39 @@
 #include <vector>
 #include <ctime>
 #include <stdexcept>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <iomanip>
+#include <cctype>
+#include <climits>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CounterRng.h"
 
 using namespace std;
 
@@ -15,16 +48,17 @@ CellGrid initializeGrid(int rows, int cols) {
 }
 
 // Funkcja do inicjalizacji komórek
-CellGrid initializeRandomCells(int rows, int cols, double liveCellProbability) {
+CellGrid initializeRandomCells(int rows, int cols, double liveCellProbability, uint64_t seed) {
     CellGrid cells(rows, vector<int>(cols, 0));
-    srand(static_cast<unsigned int>(time(0)));
+    CounterRng rng(seed);
 
-    // Losowe ustawienie komórek
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            cells[i][j] = (static_cast<double>(rand()) / RAND_MAX < liveCellProbability) ? 1 : 0;
+    // Losowe ustawienie komórek - komórka (i, j) ma własny licznik i * cols + j,
+    // więc wiersze można losować równolegle z tym samym wynikiem
+    parallelFor(rows, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            fillBernoulli(cells[i].data(), cols, liveCellProbability, rng, uint64_t(i) * cols);
         }
-    }
+    });
     return cells;
 }
 
@@ -83,200 +117,2692 @@ CellGrid initializeStableBlock(int rows, int cols) {
     return cells;
 }
 
-void drawCells(sf::RenderWindow& window, const CellGrid& cells) {
-    int cellSize = 5; // Rozmiar pojedynczej komórki
-    sf::RectangleShape cell(sf::Vector2f(cellSize - 1, cellSize - 1)); 
-    for (int i = 0; i < cells.size(); ++i) {
-        for (int j = 0; j < cells[i].size(); ++j) {
-            cell.setPosition(j * cellSize, i * cellSize); // Ustal pozycję komórki
-            if (cells[i][j] == 1) {
-                cell.setFillColor(sf::Color::Green); // Kolor żywej komórki
-            }
-            else {
-                cell.setFillColor(sf::Color::Black); // Kolor martwej komórki
-            }
-            window.draw(cell); // Rysowanie komórki
+// Reguła typu "life-like" jako maski: bit n maski birth/survive oznacza narodziny/przeżycie
+// przy n żywych sąsiadach
+struct LifeRule {
+    uint16_t birth;
+    uint16_t survive;
+};
+
+bool operator==(LifeRule a, LifeRule b) {
+    return a.birth == b.birth && a.survive == b.survive;
+}
+
+constexpr LifeRule CONWAY_RULE = { 1 << 3, (1 << 2) | (1 << 3) };                  // B3/S23
+constexpr LifeRule RULE_B23_S23 = { (1 << 2) | (1 << 3), (1 << 2) | (1 << 3) };   // B23/S23
+constexpr LifeRule RULE_B2_S = { 1 << 2, 0 };                                      // B2/S
+
+// Reguły numerowane tak jak dotychczas w programie (nieznany numer nie zmienia komórek)
+LifeRule legacyRule(int rule) {
+    switch (rule) {
+    case 40: return CONWAY_RULE;
+    case 63: return RULE_B23_S23;
+    case 26: return CONWAY_RULE;
+    case 190: return RULE_B2_S;
+    default: return { 0, 0x1FF };
+    }
+}
+
+// Zapis B/S, np. "B3/S23" albo "S23/B3" (wielkość liter bez znaczenia)
+LifeRule parseLifeRule(const string& text) {
+    LifeRule rule = { 0, 0 };
+    uint16_t* current = nullptr;
+    bool hasBirth = false, hasSurvive = false;
+    for (char c : text) {
+        if (c == 'B' || c == 'b') {
+            current = &rule.birth;
+            hasBirth = true;
+        }
+        else if (c == 'S' || c == 's') {
+            current = &rule.survive;
+            hasSurvive = true;
+        }
+        else if (c >= '0' && c <= '8' && current != nullptr) {
+            *current |= 1 << (c - '0');
+        }
+        else if (c != '/') {
+            throw invalid_argument("Niepoprawna regula: " + text);
         }
     }
+    if (!hasBirth || !hasSurvive) {
+        throw invalid_argument("Regula musi miec czesc B i S: " + text);
+    }
+    return rule;
 }
 
-int countAliveNeighborsReflecting(const CellGrid& cells, int row, int col) {
-    int aliveNeighbors = 0;
-    int rows = cells.size();
-    int cols = cells[0].size();
+// Reguła skompilowana do tablicy 512 wpisów. Indeks to 9 bitów sąsiedztwa 3x3 w kolejności
+// NW N NE W C E SW S SE (NW to najstarszy bit), tak jak w formacie MAP programu Golly
+const int NEIGHBORHOOD_SIZE = 512;
+const int CENTER_BIT = 4;
+
+struct RuleTable {
+    array<uint8_t, NEIGHBORHOOD_SIZE> next{};
+    bool isTotalistic = false; // Wynik zależy tylko od stanu komórki i liczby sąsiadów
+    LifeRule life = { 0, 0 };  // Maski B/S, gdy isTotalistic
+};
+
+int neighborCount(int index) {
+    return bitset<9>(index & ~(1 << CENTER_BIT)).count();
+}
 
-    // Sprawdzenie sąsiadów w 8 kierunkach
-    for (int x = -1; x <= 1; ++x) {
-        for (int y = -1; y <= 1; ++y) {
-            if (x == 0 && y == 0) continue; // Pomijamy siebie
+RuleTable compileRule(LifeRule rule) {
+    RuleTable table;
+    for (int index = 0; index < NEIGHBORHOOD_SIZE; ++index) {
+        uint16_t mask = (index >> CENTER_BIT) & 1 ? rule.survive : rule.birth;
+        table.next[index] = (mask >> neighborCount(index)) & 1;
+    }
+    table.isTotalistic = true;
+    table.life = rule;
+    return table;
+}
 
-            // Obliczamy indeksy sąsiadów z uwzględnieniem granic odbijających
-            int ni = row + x;
-            int nj = col + y;
+// Dowolna tablica 3x3; jeśli okaże się totalistyczna, silnik spakowany użyje sumatorów
+RuleTable compileRule(const array<uint8_t, NEIGHBORHOOD_SIZE>& next) {
+    RuleTable table;
+    table.next = next;
+    table.isTotalistic = true;
+    for (int index = 0; index < NEIGHBORHOOD_SIZE; ++index) {
+        uint16_t& mask = (index >> CENTER_BIT) & 1 ? table.life.survive : table.life.birth;
+        uint16_t bit = 1 << neighborCount(index);
+        if (next[index]) mask |= bit;
+    }
+    for (int index = 0; index < NEIGHBORHOOD_SIZE && table.isTotalistic; ++index) {
+        uint16_t mask = (index >> CENTER_BIT) & 1 ? table.life.survive : table.life.birth;
+        table.isTotalistic = ((mask >> neighborCount(index)) & 1) == (next[index] ? 1 : 0);
+    }
+    if (!table.isTotalistic) table.life = { 0, 0 };
+    return table;
+}
 
-            // Odbijanie się od granic
-            if (ni < 0) ni = -ni; // Odbicie od górnej granicy
-            if (ni >= rows) ni = 2 * rows - ni - 1; // Odbicie od dolnej granicy
-            if (nj < 0) nj = -nj; // Odbicie od lewej granicy
-            if (nj >= cols) nj = 2 * cols - nj - 1; // Odbicie od prawej granicy
+// Reguła w zapisie B/S albo "MAP" + 512 bitów tablicy zakodowanych w base64 (format Golly)
+RuleTable parseRule(const string& text) {
+    if (text.compare(0, 3, "MAP") != 0) {
+        return compileRule(parseLifeRule(text));
+    }
 
-            aliveNeighbors += cells[ni][nj]; // Dodajemy sąsiada
+    const string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    array<uint8_t, NEIGHBORHOOD_SIZE> next{};
+    int bitCount = 0;
+    for (size_t i = 3; i < text.size() && text[i] != '='; ++i) {
+        size_t value = alphabet.find(text[i]);
+        if (value == string::npos) {
+            throw invalid_argument("Niepoprawny znak w regule MAP: " + text);
         }
+        for (int b = 5; b >= 0 && bitCount < NEIGHBORHOOD_SIZE; --b) {
+            next[bitCount++] = (value >> b) & 1;
+        }
+    }
+    if (bitCount < NEIGHBORHOOD_SIZE) {
+        throw invalid_argument("Regula MAP jest za krotka: " + text);
     }
+    return compileRule(next);
+}
+
+// Warunki brzegowe jako ramka komórek-duchów wypełniana przed każdym pokoleniem, dzięki
+// czemu pętla licząca nie ma rozgałęzień ani modulo. source(-1, n) i source(n, n) podają
+// wiersz (kolumnę), z którego kopiowany jest duch, albo -1 dla stałej GHOST_VALUE.
+// WRAPS mówi, czy sąsiad zza krawędzi leży po drugiej stronie siatki
+enum class Boundary { Periodic, Reflecting, FixedDead, FixedAlive };
+
+// Zawinięcie (torus)
+struct PeriodicBoundary {
+    static const bool WRAPS = true;
+    static const int GHOST_VALUE = 0;
+    static int source(int index, int n) { return index < 0 ? n - 1 : 0; }
+};
+
+// Odbicie od granic: -1 -> 1, n -> n - 1
+struct ReflectingBoundary {
+    static const bool WRAPS = false;
+    static const int GHOST_VALUE = 0;
+    static int source(int index, int n) { return index < 0 ? min(1, n - 1) : n - 1; }
+};
+
+// Poza siatką same martwe komórki
+struct FixedDeadBoundary {
+    static const bool WRAPS = false;
+    static const int GHOST_VALUE = 0;
+    static int source(int, int) { return -1; }
+};
+
+// Poza siatką same żywe komórki
+struct FixedAliveBoundary {
+    static const bool WRAPS = false;
+    static const int GHOST_VALUE = 1;
+    static int source(int, int) { return -1; }
+};
+
+Boundary parseBoundary(const string& name) {
+    if (name == "periodic") return Boundary::Periodic;
+    if (name == "reflecting") return Boundary::Reflecting;
+    if (name == "dead") return Boundary::FixedDead;
+    if (name == "alive") return Boundary::FixedAlive;
+    throw invalid_argument("Nieznany warunek brzegowy: " + name);
+}
 
-    return aliveNeighbors;
+// action(policy) wywoływane z obiektem struktury warunku brzegowego
+template <class Action>
+void withBoundary(Boundary boundary, Action action) {
+    switch (boundary) {
+    case Boundary::Periodic: action(PeriodicBoundary()); break;
+    case Boundary::Reflecting: action(ReflectingBoundary()); break;
+    case Boundary::FixedDead: action(FixedDeadBoundary()); break;
+    case Boundary::FixedAlive: action(FixedAliveBoundary()); break;
+    }
 }
 
-// Funkcja do zliczania żywych sąsiadów z uwzględnieniem warunków brzegowych periodycznych
-int countAliveNeighborsPeriodic(const CellGrid& cells, int row, int col) {
-    int aliveNeighbors = 0;
+// Kopia siatki z ramką komórek-duchów (komórka (i, j) trafia na [i + 1][j + 1]).
+// Najpierw wiersze, potem kolumny (także w wierszach-duchach), więc narożniki
+// dostają oba odwzorowania naraz
+template <class BoundaryPolicy>
+CellGrid withGhostBorder(const CellGrid& cells) {
     int rows = cells.size();
     int cols = cells[0].size();
+    CellGrid bordered(rows + 2, vector<int>(cols + 2, int(BoundaryPolicy::GHOST_VALUE)));
+    for (int i = 0; i < rows; ++i) {
+        copy(cells[i].begin(), cells[i].end(), bordered[i + 1].begin() + 1);
+    }
 
-    // Sprawdzenie sąsiadów w 8 kierunkach
-    for (int x = -1; x <= 1; ++x) {
-        for (int y = -1; y <= 1; ++y) {
-            if (x == 0 && y == 0) continue; // Pomijamy siebie
-
-            // Obliczamy indeksy sąsiadów z uwzględnieniem granic periodycznych
-            int ni = (row + x + rows) % rows; // Użycie operatora modulo
-            int nj = (col + y + cols) % cols; // Użycie operatora modulo
+    int top = BoundaryPolicy::source(-1, rows), bottom = BoundaryPolicy::source(rows, rows);
+    if (top >= 0) bordered[0] = bordered[top + 1];
+    if (bottom >= 0) bordered[rows + 1] = bordered[bottom + 1];
 
-            aliveNeighbors += cells[ni][nj]; // Dodajemy sąsiada
-        }
+    int west = BoundaryPolicy::source(-1, cols), east = BoundaryPolicy::source(cols, cols);
+    for (vector<int>& row : bordered) {
+        if (west >= 0) row[0] = row[west + 1];
+        if (east >= 0) row[cols + 1] = row[east + 1];
     }
-
-    return aliveNeighbors;
+    return bordered;
 }
 
-// Funkcja do aktualizacji komórek zgodnie z zasadami gry w życie z uwzględnieniem reguły
-void updateCells(CellGrid& cells, int rule, bool isReflecting) {
+// Funkcja do aktualizacji komórek według skompilowanej reguły (jedno odczytanie tablicy na komórkę)
+template <class BoundaryPolicy>
+void updateCellsWith(CellGrid& cells, const RuleTable& rule) {
     int rows = cells.size();
     int cols = cells[0].size();
-    CellGrid newCells = cells; // Tworzenie nowej macierzy dla nowych wartości
+    CellGrid bordered = withGhostBorder<BoundaryPolicy>(cells);
 
     for (int i = 0; i < rows; ++i) {
+        const vector<int>& up = bordered[i];
+        const vector<int>& center = bordered[i + 1];
+        const vector<int>& down = bordered[i + 2];
         for (int j = 0; j < cols; ++j) {
-            // Zliczanie żywych sąsiadów
-            int aliveNeighbors;
-            // Zliczamy żywych sąsiadów w zależności od wybranego warunku
-            if (isReflecting) {
-                aliveNeighbors = countAliveNeighborsReflecting(cells, i, j);
-            }
-            else {
-                aliveNeighbors = countAliveNeighborsPeriodic(cells, i, j);
+            // Kolejno NW, N, NE, W, C, E, SW, S, SE
+            int index = (up[j] << 8) | (up[j + 1] << 7) | (up[j + 2] << 6)
+                | (center[j] << 5) | (center[j + 1] << 4) | (center[j + 2] << 3)
+                | (down[j] << 2) | (down[j + 1] << 1) | down[j + 2];
+            cells[i][j] = rule.next[index];
+        }
+    }
+}
+
+void updateCells(CellGrid& cells, const RuleTable& rule, Boundary boundary) {
+    withBoundary(boundary, [&](auto policy) {
+        updateCellsWith<decltype(policy)>(cells, rule);
+    });
+}
+
+void updateCells(CellGrid& cells, int rule, bool isReflecting) {
+    updateCells(cells, compileRule(legacyRule(rule)), isReflecting ? Boundary::Reflecting : Boundary::Periodic);
+}
+
+// Siatka spakowana bitowo: każdy wiersz to ciąg 64-bitowych słów, bit j słowa w odpowiada
+// kolumnie 64 * w + j. Wokół siatki jest ramka komórek-duchów: wiersze -1 i rows, słowo przed
+// pierwszym (duch kolumny -1 w najstarszym bicie) i bit kolumny cols (w ostatnim słowie
+// albo w słowie za nim). Bity za kolumną cols są zerami
+struct PackedGrid {
+    int rows = 0;
+    int cols = 0;
+    size_t wordsPerRow = 0;
+    size_t stride = 0; // wordsPerRow i dwa słowa ramki
+    vector<uint64_t> words;
+
+    PackedGrid() {}
+    PackedGrid(int rows, int cols)
+        : rows(rows), cols(cols), wordsPerRow((cols + 63) / 64), stride(wordsPerRow + 2),
+          words(size_t(rows + 2) * stride, 0) {}
+
+    uint64_t* row(int i) { return words.data() + size_t(i + 1) * stride + 1; }
+    const uint64_t* row(int i) const { return words.data() + size_t(i + 1) * stride + 1; }
+
+    int get(int i, int j) const { return (row(i)[j / 64] >> (j % 64)) & 1; }
+    void set(int i, int j, int value) {
+        uint64_t bit = uint64_t(1) << (j % 64);
+        if (value) row(i)[j / 64] |= bit;
+        else row(i)[j / 64] &= ~bit;
+    }
+};
+
+PackedGrid packGrid(const CellGrid& cells) {
+    PackedGrid grid(cells.size(), cells[0].size());
+    for (int i = 0; i < grid.rows; ++i) {
+        for (int j = 0; j < grid.cols; ++j) {
+            if (cells[i][j]) grid.row(i)[j / 64] |= uint64_t(1) << (j % 64);
+        }
+    }
+    return grid;
+}
+
+void unpackGrid(const PackedGrid& grid, CellGrid& cells) {
+    for (int i = 0; i < grid.rows; ++i) {
+        for (int j = 0; j < grid.cols; ++j) {
+            cells[i][j] = grid.get(i, j);
+        }
+    }
+}
+
+// Wypełnienie ramki siatki spakowanej według warunku brzegowego
+template <class BoundaryPolicy>
+void fillGhosts(PackedGrid& grid) {
+    int rows = grid.rows;
+    int cols = grid.cols;
+    size_t words = grid.wordsPerRow;
+    uint64_t ghostWord = BoundaryPolicy::GHOST_VALUE ? ~uint64_t(0) : 0;
+
+    int top = BoundaryPolicy::source(-1, rows), bottom = BoundaryPolicy::source(rows, rows);
+    if (top >= 0) copy(grid.row(top), grid.row(top) + words, grid.row(-1));
+    else fill(grid.row(-1), grid.row(-1) + words, ghostWord);
+    if (bottom >= 0) copy(grid.row(bottom), grid.row(bottom) + words, grid.row(rows));
+    else fill(grid.row(rows), grid.row(rows) + words, ghostWord);
+
+    int west = BoundaryPolicy::source(-1, cols), east = BoundaryPolicy::source(cols, cols);
+    size_t eastWord = cols / 64;
+    int eastBit = cols % 64;
+    for (int i = -1; i <= rows; ++i) {
+        uint64_t* row = grid.row(i);
+        uint64_t westValue = west >= 0 ? (row[west / 64] >> (west % 64)) & 1 : uint64_t(BoundaryPolicy::GHOST_VALUE);
+        uint64_t eastValue = east >= 0 ? (row[east / 64] >> (east % 64)) & 1 : uint64_t(BoundaryPolicy::GHOST_VALUE);
+        row[-1] = westValue << 63;
+        row[eastWord] = (row[eastWord] & ~(uint64_t(1) << eastBit)) | (eastValue << eastBit);
+    }
+}
+
+// Sąsiedzi z lewej (bit c = komórka c - 1) dla słowa w wiersza, z ramką dla w = 0
+inline uint64_t westNeighbors(const uint64_t* row, size_t w) {
+    return (row[w] << 1) | ((row - 1)[w] >> 63);
+}
+
+// Sąsiedzi z prawej (bit c = komórka c + 1), z ramką dla ostatniej kolumny
+inline uint64_t eastNeighbors(const uint64_t* row, size_t w) {
+    return (row[w] >> 1) | (row[w + 1] << 63);
+}
+
+// Sumator pełny na 64 bitach naraz
+inline void fullAdder(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry) {
+    uint64_t ab = a ^ b;
+    sum = ab ^ c;
+    carry = (a & b) | (ab & c);
+}
+
+// Nowy stan 64 komórek z dziewięciu plansz sąsiedztwa (kolejność jak w RuleTable):
+// liczba sąsiadów składana jest z sumatorów pełnych w 4 bity (count0..count3),
+// a maski birth/survive wybierają narodziny i przeżycia
+inline uint64_t lifeKernel(const uint64_t board[9], uint16_t birth, uint16_t survive) {
+    uint64_t up0, up1, down0, down1;
+    fullAdder(board[0], board[1], board[2], up0, up1);
+    fullAdder(board[6], board[7], board[8], down0, down1);
+    uint64_t middle0 = board[3] ^ board[5];
+    uint64_t middle1 = board[3] & board[5];
+
+    uint64_t count0, carry0, twos0, twos1;
+    fullAdder(up0, down0, middle0, count0, carry0);
+    fullAdder(up1, down1, middle1, twos0, twos1);
+    uint64_t count1 = twos0 ^ carry0;
+    uint64_t carry1 = twos0 & carry0;
+    uint64_t count2 = twos1 ^ carry1;
+    uint64_t count3 = twos1 & carry1;
+
+    uint64_t born = 0, survives = 0;
+    for (int n = 0; n <= 8; ++n) {
+        if (!(((birth | survive) >> n) & 1)) continue;
+        uint64_t equal = ((n & 1) ? count0 : ~count0) & ((n & 2) ? count1 : ~count1)
+            & ((n & 4) ? count2 : ~count2) & ((n & 8) ? count3 : ~count3);
+        if ((birth >> n) & 1) born |= equal;
+        if ((survive >> n) & 1) survives |= equal;
+    }
+    uint64_t center = board[CENTER_BIT];
+    return (born & ~center) | (survives & center);
+}
+
+// Reguła znana w czasie kompilacji - kompilator rozwija pętlę po liczbie sąsiadów
+// i zostawia tylko potrzebne porównania
+template <uint16_t Birth, uint16_t Survive>
+struct StaticLifeKernel {
+    uint64_t operator()(const uint64_t board[9]) const {
+        return lifeKernel(board, Birth, Survive);
+    }
+};
+
+// Dowolna reguła totalistyczna z maskami w czasie działania
+struct LifeKernel {
+    LifeRule rule;
+
+    uint64_t operator()(const uint64_t board[9]) const {
+        return lifeKernel(board, rule.birth, rule.survive);
+    }
+};
+
+// Dowolna tablica 3x3: multiplekser Shannona po kolejnych bitach indeksu, od SE do NW
+struct TableKernel {
+    const RuleTable* table;
+
+    uint64_t operator()(const uint64_t board[9]) const {
+        uint64_t level[NEIGHBORHOOD_SIZE / 2];
+        uint64_t se = board[8];
+        for (int k = 0; k < NEIGHBORHOOD_SIZE / 2; ++k) {
+            uint64_t low = uint64_t(0) - table->next[2 * k];
+            uint64_t high = uint64_t(0) - table->next[2 * k + 1];
+            level[k] = (se & high) | (~se & low);
+        }
+        for (int b = 7, width = NEIGHBORHOOD_SIZE / 4; b >= 0; --b, width /= 2) {
+            uint64_t x = board[b];
+            for (int k = 0; k < width; ++k) {
+                level[k] = (x & level[2 * k + 1]) | (~x & level[2 * k]);
             }
+        }
+        return level[0];
+    }
+};
 
-            if (rule == 40)
-            {
-                if (cells[i][j] == 1) { // Komórka żywa
-                    if (aliveNeighbors < 2 || aliveNeighbors > 3) {
-                        newCells[i][j] = 0; // Umiera
-                    }
-                }
-                else { // Komórka martwa
-                    if (aliveNeighbors == 3) {
-                        newCells[i][j] = 1; // Ożywa
-                    }
+// Nowy stan słowa w wiersza z trzech wierszy wejścia (kernel(board), gdzie board to
+// 9 plansz sąsiedztwa)
+template <class Kernel>
+inline uint64_t packedWord(const uint64_t* up, const uint64_t* center, const uint64_t* down, size_t w,
+    const Kernel& kernel) {
+    uint64_t board[9] = {
+        westNeighbors(up, w), up[w], eastNeighbors(up, w),
+        westNeighbors(center, w), center[w], eastNeighbors(center, w),
+        westNeighbors(down, w), down[w], eastNeighbors(down, w)
+    };
+    return kernel(board);
+}
+
+// Numer najniższego i najwyższego ustawionego bitu (x != 0) przez zliczanie bitów,
+// tak jak populacja w pozostałych miejscach programu
+inline int lowestBit(uint64_t x) {
+    return int(bitset<64>((x & (0 - x)) - 1).count());
+}
+
+inline int highestBit(uint64_t x) {
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    x |= x >> 32;
+    return int(bitset<64>(x).count()) - 1;
+}
+
+// Statystyki zbierane przy liczeniu bloku siatki spakowanej, słowo po słowie i wiersz
+// po wierszu, bez osobnego przejścia po siatce: narodziny, śmierci i prostokąt otaczający
+// żywe komórki po kroku (pusty, gdy minRow > maxRow). Bity liczone są tylko w słowach,
+// które się zmieniły, więc populację prowadzi się przyrostowo: poprzednia + births - deaths
+struct BlockStats {
+    uint64_t births = 0;
+    uint64_t deaths = 0;
+    int minRow = INT_MAX;
+    int maxRow = -1;
+    // Skrajne kolumny trzymane jako słowo i suma bitów wierszy, które na nim się zaczynają
+    // (kończą) - numer bitu liczony jest dopiero w minCol() i maxCol()
+    size_t firstWord = SIZE_MAX;
+    uint64_t firstBits = 0;
+    size_t lastWord = 0;
+    uint64_t lastBits = 0;
+
+    // Słowo przed krokiem (before) i po nim (after)
+    void add(uint64_t before, uint64_t after) {
+        uint64_t changed = before ^ after;
+        if (changed) {
+            births += bitset<64>(changed & after).count();
+            deaths += bitset<64>(changed & before).count();
+        }
+    }
+
+    // Prostokąt liczony raz na wiersz, od skrajnych niezerowych słów [wordBegin, wordEnd)
+    // policzonego wiersza - zwykle to pierwsze i ostatnie słowo, więc koszt jest stały
+    void addRow(int row, const uint64_t* result, size_t wordBegin, size_t wordEnd) {
+        size_t first = wordBegin;
+        while (first < wordEnd && result[first] == 0) ++first;
+        if (first == wordEnd) return;
+        size_t last = wordEnd - 1;
+        while (result[last] == 0) --last;
+
+        minRow = min(minRow, row);
+        maxRow = max(maxRow, row);
+        addColumns(first, result[first], last, result[last]);
+    }
+
+    void merge(const BlockStats& other) {
+        births += other.births;
+        deaths += other.deaths;
+        minRow = min(minRow, other.minRow);
+        maxRow = max(maxRow, other.maxRow);
+        if (other.maxRow >= 0) addColumns(other.firstWord, other.firstBits, other.lastWord, other.lastBits);
+    }
+
+    int minCol() const { return maxRow < 0 ? -1 : int(64 * firstWord) + lowestBit(firstBits); }
+    int maxCol() const { return maxRow < 0 ? -1 : int(64 * lastWord) + highestBit(lastBits); }
+
+private:
+    void addColumns(size_t first, uint64_t firstRow, size_t last, uint64_t lastRow) {
+        if (first < firstWord) {
+            firstWord = first;
+            firstBits = firstRow;
+        }
+        else if (first == firstWord) {
+            firstBits |= firstRow;
+        }
+        if (last > lastWord || lastBits == 0) {
+            lastWord = last;
+            lastBits = lastRow;
+        }
+        else if (last == lastWord) {
+            lastBits |= lastRow;
+        }
+    }
+};
+
+// Zamiennik BlockStats, gdy statystyki nie są potrzebne - kompilator usuwa wywołania
+struct NoStats {
+    void add(uint64_t, uint64_t) {}
+    void addRow(int, const uint64_t*, size_t, size_t) {}
+};
+
+// Nowe stany prostokąta wierszy [rowBegin, rowEnd) i słów [wordBegin, wordEnd) siatki
+// spakowanej - te same wyniki co updateCells, ale 64 komórki liczone są naraz. Ramka
+// wejścia musi być wypełniona. Zwraca true, jeśli coś się zmieniło; stats dostaje
+// każde policzone słowo
+template <class Kernel, class Stats>
+bool updatePackedBlock(const PackedGrid& in, PackedGrid& out, const Kernel& kernel,
+    int rowBegin, int rowEnd, size_t wordBegin, size_t wordEnd, Stats& stats) {
+    Stats local = stats; // Kopia lokalna: zapisy do out nie mogą jej nadpisać, więc zostaje w rejestrach
+    size_t lastWord = in.wordsPerRow - 1;
+    int lastBit = (in.cols - 1) % 64;
+    uint64_t lastMask = lastBit == 63 ? ~uint64_t(0) : (uint64_t(1) << (lastBit + 1)) - 1;
+    size_t fullEnd = min(wordEnd, lastWord); // Słowa, których nie trzeba maskować
+    uint64_t changed = 0;
+
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        const uint64_t* up = in.row(i - 1);
+        const uint64_t* center = in.row(i);
+        const uint64_t* down = in.row(i + 1);
+        uint64_t* result = out.row(i);
+
+        for (size_t w = wordBegin; w < fullEnd; ++w) {
+            result[w] = packedWord(up, center, down, w, kernel);
+            changed |= result[w] ^ center[w];
+            local.add(center[w], result[w]);
+        }
+        if (wordEnd > lastWord) {
+            result[lastWord] = packedWord(up, center, down, lastWord, kernel) & lastMask;
+            changed |= result[lastWord] ^ (center[lastWord] & lastMask);
+            local.add(center[lastWord] & lastMask, result[lastWord]);
+        }
+        local.addRow(i, result, wordBegin, wordEnd);
+    }
+    stats = local;
+    return changed != 0;
+}
+
+template <class Kernel>
+bool updatePackedBlock(const PackedGrid& in, PackedGrid& out, const Kernel& kernel,
+    int rowBegin, int rowEnd, size_t wordBegin, size_t wordEnd) {
+    NoStats none;
+    return updatePackedBlock(in, out, kernel, rowBegin, rowEnd, wordBegin, wordEnd, none);
+}
+
+template <class BoundaryPolicy, class Kernel, class Stats>
+void updatePackedCellsWith(PackedGrid& in, PackedGrid& out, const Kernel& kernel, Stats& stats) {
+    fillGhosts<BoundaryPolicy>(in);
+    updatePackedBlock(in, out, kernel, 0, in.rows, 0, in.wordsPerRow, stats);
+}
+
+// Wybór jądra: reguły używane w programie mają własne specjalizacje, pozostałe
+// totalistyczne idą przez maski, a nietotalistyczne przez tablicę. action(kernel)
+// jest wywoływane z jądrem właściwego typu
+template <class Action>
+void withKernel(const RuleTable& rule, Action action) {
+    if (!rule.isTotalistic) {
+        action(TableKernel{ &rule });
+    }
+    else if (rule.life == CONWAY_RULE) {
+        action(StaticLifeKernel<CONWAY_RULE.birth, CONWAY_RULE.survive>());
+    }
+    else if (rule.life == RULE_B23_S23) {
+        action(StaticLifeKernel<RULE_B23_S23.birth, RULE_B23_S23.survive>());
+    }
+    else if (rule.life == RULE_B2_S) {
+        action(StaticLifeKernel<RULE_B2_S.birth, RULE_B2_S.survive>());
+    }
+    else {
+        action(LifeKernel{ rule.life });
+    }
+}
+
+// action(policy, kernel) dla warunku brzegowego i jądra reguły
+template <class Action>
+void withBoundaryAndKernel(Boundary boundary, const RuleTable& rule, Action action) {
+    withBoundary(boundary, [&](auto policy) {
+        withKernel(rule, [&](const auto& kernel) {
+            action(policy, kernel);
+        });
+    });
+}
+
+void updatePackedCells(PackedGrid& in, PackedGrid& out, const RuleTable& rule, Boundary boundary) {
+    NoStats none;
+    withBoundaryAndKernel(boundary, rule, [&](auto policy, const auto& kernel) {
+        updatePackedCellsWith<decltype(policy)>(in, out, kernel, none);
+    });
+}
+
+// Krok ze statystykami pokolenia (stats jest zerowane)
+void updatePackedCells(PackedGrid& in, PackedGrid& out, const RuleTable& rule, Boundary boundary,
+    BlockStats& stats) {
+    stats = BlockStats();
+    withBoundaryAndKernel(boundary, rule, [&](auto policy, const auto& kernel) {
+        updatePackedCellsWith<decltype(policy)>(in, out, kernel, stats);
+    });
+}
+
+// Śledzenie aktywnych kafelków. Kafelek to jedno słowo szerokości (64 kolumny) i TILE_ROWS
+// wierszy; liczone są tylko kafelki, które same lub których sąsiedzi zmienili się
+// w ostatnim pokoleniu. Pominięty kafelek nie jest nawet kopiowany: w drugim buforze
+// leży jego stan sprzed pokolenia, który jest taki sam jak obecny
+const int TILE_ROWS = 16;
+
+struct TileActivity {
+    int tileRows = 0;
+    int tileCols = 0;
+    vector<size_t> changed;  // Kafelki zmienione w ostatnim pokoleniu
+    vector<size_t> active;   // Kafelki do policzenia w bieżącym pokoleniu
+    vector<uint8_t> isActive;
+    vector<BlockStats> tileStats; // Statystyki kafelków (tylko przy krokach ze statystykami)
+
+    TileActivity() {}
+    TileActivity(const PackedGrid& grid)
+        : tileRows((grid.rows + TILE_ROWS - 1) / TILE_ROWS), tileCols(grid.wordsPerRow),
+          isActive(size_t(tileRows) * tileCols, 0) {
+        markAll();
+    }
+
+    // Wymusza policzenie wszystkich kafelków, np. po zmianie reguły lub ręcznej zmianie siatki
+    // (oba bufory siatki muszą wtedy zostać w całości nadpisane)
+    void markAll() {
+        changed.resize(isActive.size());
+        for (size_t tile = 0; tile < changed.size(); ++tile) changed[tile] = tile;
+    }
+};
+
+template <class BoundaryPolicy, class Kernel, bool WithStats>
+void updateActiveTilesWith(PackedGrid& in, PackedGrid& out, const Kernel& kernel, TileActivity& activity) {
+    int tileRows = activity.tileRows;
+    int tileCols = activity.tileCols;
+    fillGhosts<BoundaryPolicy>(in);
+
+    // Kafelki do policzenia: zmienione i ich sąsiedzi. Przy zawinięciu sąsiad zza krawędzi
+    // to kafelek z drugiej strony; przy pozostałych warunkach duchy zależą tylko od tego samego
+    // kafelka albo są stałe
+    activity.active.clear();
+    for (size_t tile : activity.changed) {
+        int ti = tile / tileCols;
+        int tj = tile % tileCols;
+        for (int x = -1; x <= 1; ++x) {
+            for (int y = -1; y <= 1; ++y) {
+                int ni = ti + x;
+                int nj = tj + y;
+                if (BoundaryPolicy::WRAPS) {
+                    ni = (ni + tileRows) % tileRows;
+                    nj = (nj + tileCols) % tileCols;
                 }
-            }
-            else if (rule == 63)
-            {
-                if (cells[i][j] == 1) { // Komórka żywa
-                    // Żywa komórka umiera, jeśli ma 0, 1, lub 4-8 żywych sąsiadów
-                    if (aliveNeighbors == 0 || aliveNeighbors == 1 || aliveNeighbors >= 4) {
-                        newCells[i][j] = 0; // Umiera
-                    }
+                else if (ni < 0 || ni >= tileRows || nj < 0 || nj >= tileCols) {
+                    continue;
                 }
-                else { // Komórka martwa
-                    // Martwa komórka ożywa, jeśli ma dokładnie 2 lub 3 żywych sąsiadów
-                    if (aliveNeighbors == 2 || aliveNeighbors == 3) {
-                        newCells[i][j] = 1; // Ożywa
-                    }
+                size_t neighbor = size_t(ni) * tileCols + nj;
+                if (!activity.isActive[neighbor]) {
+                    activity.isActive[neighbor] = 1;
+                    activity.active.push_back(neighbor);
                 }
             }
-            else if (rule == 26)
+        }
+    }
+
+    activity.changed.clear();
+    for (size_t tile : activity.active) {
+        activity.isActive[tile] = 0;
+        int ti = tile / tileCols;
+        int tj = tile % tileCols;
+        int rowBegin = ti * TILE_ROWS, rowEnd = min(in.rows, (ti + 1) * TILE_ROWS);
+        bool changed;
+        if (WithStats) {
+            // Statystyki kafelka zastępują poprzednie; pominięte kafelki zachowują swoje
+            activity.tileStats[tile] = BlockStats();
+            changed = updatePackedBlock(in, out, kernel, rowBegin, rowEnd, tj, tj + 1, activity.tileStats[tile]);
+        }
+        else {
+            changed = updatePackedBlock(in, out, kernel, rowBegin, rowEnd, tj, tj + 1);
+        }
+        if (changed) activity.changed.push_back(tile);
+    }
+}
+
+void updateActiveTiles(PackedGrid& in, PackedGrid& out, const RuleTable& rule, Boundary boundary,
+    TileActivity& activity) {
+    withBoundaryAndKernel(boundary, rule, [&](auto policy, const auto& kernel) {
+        updateActiveTilesWith<decltype(policy), decay_t<decltype(kernel)>, false>(in, out, kernel, activity);
+    });
+}
+
+// Krok ze statystykami pokolenia: liczniki kafelków policzonych w tym pokoleniu są świeże,
+// pominięte kafelki się nie zmieniły, więc wnoszą tylko swój prostokąt, bez narodzin
+// i śmierci. Sumowanie idzie po licznikach kafelków (jeden na 64 x TILE_ROWS komórek)
+void updateActiveTiles(PackedGrid& in, PackedGrid& out, const RuleTable& rule, Boundary boundary,
+    TileActivity& activity, BlockStats& stats) {
+    if (activity.tileStats.size() != activity.isActive.size()) {
+        activity.tileStats.assign(activity.isActive.size(), BlockStats());
+        activity.markAll();
+    }
+    withBoundaryAndKernel(boundary, rule, [&](auto policy, const auto& kernel) {
+        updateActiveTilesWith<decltype(policy), decay_t<decltype(kernel)>, true>(in, out, kernel, activity);
+    });
+
+    stats = BlockStats();
+    for (BlockStats& tile : activity.tileStats) {
+        stats.merge(tile);
+        tile.births = 0;
+        tile.deaths = 0;
+    }
+}
+
+// Równoległy krok na pasach wierszy. Siatka dzielona jest na pasy po PARALLEL_CHUNK_ROWS
+// wierszy; każdy wątek dostaje na początku pokolenia ciągły zakres pasów, a gdy skończy
+// swoje, podkrada połowę zakresu innego wątku. Zakres [begin, end) jednego wątku trzyma
+// jedna 64-bitowa zmienna atomowa zmieniana przez CAS (właściciel bierze od początku,
+// złodziej od końca). Pasy brzegowe (halo) sąsiadów czytane są z bufora wejściowego,
+// więc wymiana halo to bariera między pokoleniami - licznik i faza na zmiennych atomowych,
+// bez blokad; ostatni wątek na barierze wypełnia ramkę następnego wejścia. Każdy wiersz liczy ta sama funkcja co w updatePackedCells, więc wynik jest
+// identyczny co do bitu z krokiem szeregowym. Statystyki pokolenia każdy wątek zbiera
+// we własnym liczniku, a ostatni na barierze sumuje je i przekazuje obserwatorowi
+const int PARALLEL_CHUNK_ROWS = 8;
+
+class ParallelLifeStepper {
+public:
+    explicit ParallelLifeStepper(unsigned threads = 0)
+        : threadCount(threads == 0 ? max(1u, thread::hardware_concurrency()) : threads), ranges(threadCount),
+          threadStats(threadCount) {
+        for (unsigned t = 1; t < threadCount; ++t) {
+            workers.emplace_back(&ParallelLifeStepper::workerLoop, this, t);
+        }
+    }
+
+    ~ParallelLifeStepper() {
+        {
+            lock_guard<mutex> lock(jobMutex);
+            stopping = true;
+            ++jobId;
+        }
+        jobReady.notify_all();
+        for (thread& worker : workers) worker.join();
+    }
+
+    ParallelLifeStepper(const ParallelLifeStepper&) = delete;
+    ParallelLifeStepper& operator=(const ParallelLifeStepper&) = delete;
+
+    // Przesunięcie grid o generations pokoleń; scratch to drugi bufor tego samego rozmiaru.
+    // observe (jeśli podane) dostaje statystyki każdego pokolenia, kolejno, z wątku,
+    // który ostatni dotarł do bariery - wywołania nigdy się nie nakładają
+    void advance(PackedGrid& grid, PackedGrid& scratch, const RuleTable& rule, Boundary boundary, int generations,
+        const function<void(const BlockStats&)>& observe = nullptr) {
+        if (generations <= 0) return;
+
+        withBoundaryAndKernel(boundary, rule, [&](auto policy, const auto& kernel) {
+            using BoundaryPolicy = decltype(policy);
+            if (observe) {
+                computeRows = [&kernel](const PackedGrid& in, PackedGrid& out, int rowBegin, int rowEnd, BlockStats& stats) {
+                    updatePackedBlock(in, out, kernel, rowBegin, rowEnd, 0, in.wordsPerRow, stats);
+                };
+            }
+            else {
+                computeRows = [&kernel](const PackedGrid& in, PackedGrid& out, int rowBegin, int rowEnd, BlockStats&) {
+                    updatePackedBlock(in, out, kernel, rowBegin, rowEnd, 0, in.wordsPerRow);
+                };
+            }
+            observeGeneration = observe;
+            for (PaddedStats& slot : threadStats) slot.stats = BlockStats();
+            fillGhostsOf = [](PackedGrid& input) {
+                fillGhosts<BoundaryPolicy>(input);
+            };
+            buffers[0] = &grid;
+            buffers[1] = &scratch;
+            jobGenerations = generations;
+            completedGenerations = 0;
+            chunkCount = (grid.rows + PARALLEL_CHUNK_ROWS - 1) / PARALLEL_CHUNK_ROWS;
+            fillGhostsOf(grid);
+            resetRanges();
             {
-                if (cells[i][j] == 1) { // Komórka żywa
-                    // Żywa komórka umiera, jeśli ma 0, 1, 4, 5, 6, 7 lub 8 żywych sąsiadów
-                    if (aliveNeighbors == 0 || aliveNeighbors == 1 || aliveNeighbors == 4 || aliveNeighbors == 5 || aliveNeighbors == 6 || aliveNeighbors == 7 || aliveNeighbors == 8) {
-                        newCells[i][j] = 0; // Umiera
-                    }
-                }
-                else { // Komórka martwa
-                    // Martwa komórka ożywa, jeśli ma dokładnie 3 żywych sąsiadów
-                    if (aliveNeighbors == 3) {
-                        newCells[i][j] = 1; // Ożywa
-                    }
-                }
+                lock_guard<mutex> lock(jobMutex);
+                ++jobId;
             }
-            else if (rule == 190)
+            jobReady.notify_all();
+
+            // Wątek wywołujący jest wątkiem numer 0
+            work(0);
+        });
+
+        if (generations % 2 == 1) swap(grid, scratch);
+    }
+
+    unsigned threads() const { return threadCount; }
+
+private:
+    // Zmienna atomowa w osobnej linii pamięci podręcznej
+    struct PaddedRange {
+        atomic<uint64_t> value{ 0 };
+        char padding[64 - sizeof(atomic<uint64_t>)];
+    };
+
+    // Liczniki jednego wątku, oddzielone od liczników sąsiada
+    struct PaddedStats {
+        BlockStats stats;
+        char padding[64];
+    };
+
+    static uint64_t packRange(uint32_t begin, uint32_t end) { return (uint64_t(begin) << 32) | end; }
+
+    void workerLoop(unsigned self) {
+        uint64_t seenJob = 0;
+        while (true) {
             {
-                if (cells[i][j] == 1) { // Komórka żywa
-                    newCells[i][j] = 0; // Żywa komórka umiera
+                unique_lock<mutex> lock(jobMutex);
+                jobReady.wait(lock, [&] { return jobId != seenJob; });
+                seenJob = jobId;
+                if (stopping) return;
+            }
+            work(self);
+        }
+    }
+
+    void work(unsigned self) {
+        int generations = jobGenerations;
+        for (int g = 0; g < generations; ++g) {
+            const PackedGrid& in = *buffers[g % 2];
+            PackedGrid& out = *buffers[1 - g % 2];
+            BlockStats& stats = threadStats[self].stats;
+            int chunk;
+            while ((chunk = nextChunk(self)) >= 0) {
+                computeRows(in, out, chunk * PARALLEL_CHUNK_ROWS, min(in.rows, (chunk + 1) * PARALLEL_CHUNK_ROWS), stats);
+            }
+            arriveAndWait();
+        }
+    }
+
+    // Następny pas do policzenia: najpierw z własnego zakresu, potem kradziony; -1 gdy brak
+    int nextChunk(unsigned self) {
+        atomic<uint64_t>& own = ranges[self].value;
+        uint64_t range = own.load(memory_order_acquire);
+        while (uint32_t(range >> 32) < uint32_t(range)) {
+            uint32_t begin = uint32_t(range >> 32);
+            if (own.compare_exchange_weak(range, packRange(begin + 1, uint32_t(range)), memory_order_acq_rel)) {
+                return begin;
+            }
+        }
+
+        for (unsigned offset = 1; offset < threadCount; ++offset) {
+            atomic<uint64_t>& victim = ranges[(self + offset) % threadCount].value;
+            uint64_t stolen = victim.load(memory_order_acquire);
+            while (uint32_t(stolen >> 32) < uint32_t(stolen)) {
+                uint32_t begin = uint32_t(stolen >> 32);
+                uint32_t end = uint32_t(stolen);
+                uint32_t split = end - max<uint32_t>(1, (end - begin) / 2);
+                if (victim.compare_exchange_weak(stolen, packRange(begin, split), memory_order_acq_rel)) {
+                    // Pierwszy skradziony pas od razu, reszta do własnego (pustego) zakresu
+                    own.store(packRange(split + 1, end), memory_order_release);
+                    return split;
                 }
-                else { // Komórka martwa
-                    // Martwa komórka ożywa, jeśli ma dokładnie 2 żywych sąsiadów
-                    if (aliveNeighbors == 2) {
-                        newCells[i][j] = 1; // Ożywa
-                    }
+            }
+        }
+        return -1;
+    }
+
+    // Pokolenie dzielone po równo między wątki
+    void resetRanges() {
+        for (unsigned t = 0; t < threadCount; ++t) {
+            uint32_t begin = uint32_t(uint64_t(chunkCount) * t / threadCount);
+            uint32_t end = uint32_t(uint64_t(chunkCount) * (t + 1) / threadCount);
+            ranges[t].value.store(packRange(begin, end), memory_order_relaxed);
+        }
+    }
+
+    // Bariera z odwracaną fazą; ostatni wątek przygotowuje ramkę i zakresy następnego pokolenia
+    void arriveAndWait() {
+        unsigned phase = barrierPhase.load(memory_order_acquire);
+        if (barrierCount.fetch_add(1, memory_order_acq_rel) + 1 == threadCount) {
+            barrierCount.store(0, memory_order_relaxed);
+            if (observeGeneration) {
+                BlockStats total;
+                for (PaddedStats& slot : threadStats) {
+                    total.merge(slot.stats);
+                    slot.stats = BlockStats();
                 }
+                observeGeneration(total);
             }
+            if (++completedGenerations < jobGenerations) {
+                fillGhostsOf(*buffers[completedGenerations % 2]);
+            }
+            resetRanges();
+            barrierPhase.store(phase + 1, memory_order_release);
+            return;
+        }
+        for (int spin = 0; barrierPhase.load(memory_order_acquire) == phase; ++spin) {
+            if (spin > 64) this_thread::yield();
         }
     }
-    cells = newCells; 
-}
 
-void updateWindowTitle(sf::RenderWindow& window, int rule) {
-    window.setTitle("Regula: " + std::to_string(rule));
-}
+    unsigned threadCount;
+    vector<PaddedRange> ranges;
+    vector<PaddedStats> threadStats;
+    vector<thread> workers;
 
-int main() {
-    int rows = 200, cols = 200, steps = 20; 
-    vector<int> rules = { 40, 63, 26, 190 }; 
-    int currentRuleIndex = 0; 
-    bool isReflecting = false;
+    // Bieżące zadanie (ustawiane przed zwiększeniem jobId)
+    function<void(const PackedGrid&, PackedGrid&, int, int, BlockStats&)> computeRows;
+    function<void(PackedGrid&)> fillGhostsOf;
+    function<void(const BlockStats&)> observeGeneration;
+    PackedGrid* buffers[2] = { nullptr, nullptr };
+    int jobGenerations = 0;
+    int completedGenerations = 0;
+    int chunkCount = 0;
 
-    try {
-        CellGrid cells = initializeGrid(rows, cols);
+    atomic<unsigned> barrierCount{ 0 };
+    atomic<unsigned> barrierPhase{ 0 };
 
-        // Glider
-        placeGlider(cells);
+    // Uśpienie wątków między zadaniami
+    mutex jobMutex;
+    condition_variable jobReady;
+    uint64_t jobId = 0;
+    bool stopping = false;
+};
 
-        // Oscylator
-        //placeToad(cells);
+// Sposób traktowania świata przez HashLife: nieskończona płaszczyzna martwych komórek
+// albo torus (siatka kwadratowa o boku będącym potęgą dwójki, jak warunek periodyczny)
+enum class HashLifeWorld { Plane, Torus };
 
-        // Losowe
-       // cells = initializeRandomCells(rows, cols, 0.05);
+// Silnik HashLife: drzewo czwórkowe z kanonicznymi (współdzielonymi) węzłami i zapamiętanymi
+// wynikami. Węzeł poziomu k to kwadrat 2^k x 2^k; jego wynik to środkowy kwadrat
+// 2^(k-1) x 2^(k-1) po 2^(k-2) pokoleniach (albo po 2^j pokoleniach dla mniejszych kroków).
+// Reguła przychodzi jako ta sama RuleTable co dla updateCells, więc wzorzec można
+// przenosić między silnikami przez load/store
+class HashLife2D {
+public:
+    HashLife2D(const RuleTable& rule, HashLifeWorld world = HashLifeWorld::Plane, size_t memoryBudgetBytes = size_t(256) << 20)
+        : rule(rule), world(world), maxNodes(max<size_t>(4096, memoryBudgetBytes / BYTES_PER_NODE)) {
+        if (world == HashLifeWorld::Plane && rule.next[0]) {
+            throw invalid_argument("HashLife na plaszczyznie nie obsluguje regul z B0");
+        }
+    }
 
-        // Niezmienny
-       // cells = initializeStableBlock(rows, cols);
+    // Wczytanie siatki. Na płaszczyźnie komórka (i, j) trafia na współrzędne (i, j);
+    // torus wymaga siatki kwadratowej o boku 2^k (co najmniej 16)
+    void load(const CellGrid& cells) {
+        int rows = cells.size();
+        int cols = cells[0].size();
+        int level = LEAF_LEVEL + 1;
+        while ((int64_t(1) << level) < max(rows, cols)) ++level;
 
-        // Tworzenie okna SFML
-        sf::RenderWindow window(sf::VideoMode(cols * 5, rows * 5), "Automat Komorkowy - Gra w Zycie - Reguła: " + std::to_string(rules[currentRuleIndex]));
+        if (world == HashLifeWorld::Torus && (rows != cols || (int64_t(1) << level) != rows)) {
+            throw invalid_argument("HashLife na torusie wymaga siatki kwadratowej o boku 2^k (min. 16)");
+        }
 
-        while (window.isOpen()) {
-            sf::Event event;
-            while (window.pollEvent(event)) {
-                if (event.type == sf::Event::Closed)
-                    window.close(); 
+        clear();
+        root = build(cells, 0, 0, level);
+        liveNodes = nodes.size();
+        top = 0;
+        left = 0;
+        generation = 0;
+    }
+
+    // Zapis okna o rozmiarze siatki, zaczynającego się w punkcie (0, 0) płaszczyzny
+    // (na torusie - całej siatki)
+    void store(CellGrid& cells) const {
+        for (vector<int>& row : cells) fill(row.begin(), row.end(), 0);
+        forEachLiveCell([&](int64_t i, int64_t j) {
+            if (i >= 0 && j >= 0 && i < int64_t(cells.size()) && j < int64_t(cells[0].size())) {
+                cells[i][j] = 1;
             }
+        });
+    }
 
-            //cout << "Aktualna reguła: " << rules[currentRuleIndex] << endl;
+    void advance(uint64_t generations) {
+        if (world == HashLifeWorld::Torus) {
+            advanceTorus(generations);
+        }
+        else {
+            for (int j = 0; generations != 0; ++j, generations >>= 1) {
+                if (generations & 1) stepPlane(j);
+            }
+        }
+    }
+
+    // Wywołuje visit(i, j) dla każdej żywej komórki (współrzędne płaszczyzny)
+    template <class Visit>
+    void forEachLiveCell(Visit visit) const {
+        visitLive(root, top, left, visit);
+    }
 
-            for (int step = 0; step < steps; ++step) {
-                updateCells(cells, rules[currentRuleIndex], isReflecting); 
-                window.clear(); 
-                drawCells(window, cells); 
+    uint64_t population() const { return nodes[root].population; }
+    uint64_t generationCount() const { return generation; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t collections() const { return collectionCount; }
 
-                updateWindowTitle(window, rules[currentRuleIndex]);
+private:
+    static const int LEAF_LEVEL = 3;              // Liść = 8 x 8 komórek w jednym słowie
+    static const uint32_t NO_NODE = 0xFFFFFFFFu;
+    static const size_t BYTES_PER_NODE = 128;     // Węzeł + wpisy w tablicach haszujących (szacunkowo)
 
-                window.display();
+    struct Node {
+        uint32_t nw, ne, sw, se;
+        uint64_t bits;        // Komórki liścia: bit 8 * wiersz + kolumna
+        uint64_t population;
+        uint32_t result;      // Zapamiętany wynik po 2^(level-2) pokoleniach albo NO_NODE
+        int level;
+    };
 
-            }
+    // Przerwanie kroku po przekroczeniu budżetu pamięci w trakcie rekurencji
+    struct BudgetExceeded {};
+
+    struct NodeKey {
+        uint32_t nw, ne, sw, se;
+        bool operator==(const NodeKey& other) const {
+            return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+        }
+    };
+
+    struct NodeKeyHash {
+        size_t operator()(const NodeKey& key) const {
+            uint64_t h = (uint64_t(key.nw) << 32 | key.ne) * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t(key.sw) << 32 | key.se) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+            return size_t(h ^ (h >> 29));
+        }
+    };
+
+    void clear() {
+        nodes.clear();
+        leaves.clear();
+        joins.clear();
+        stepMemo.clear();
+        uniformNodes[0].clear();
+        uniformNodes[1].clear();
+    }
+
+    uint32_t leaf(uint64_t bits) {
+        auto found = leaves.find(bits);
+        if (found != leaves.end()) return found->second;
+
+        nodes.push_back({ NO_NODE, NO_NODE, NO_NODE, NO_NODE, bits, uint64_t(bitset<64>(bits).count()), NO_NODE, LEAF_LEVEL });
+        uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+        leaves.emplace(bits, id);
+        return id;
+    }
+
+    uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+        NodeKey key = { nw, ne, sw, se };
+        auto found = joins.find(key);
+        if (found != joins.end()) return found->second;
+
+        uint64_t population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+        nodes.push_back({ nw, ne, sw, se, 0, population, NO_NODE, nodes[nw].level + 1 });
+        uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+        joins.emplace(key, id);
+        return id;
+    }
 
-            currentRuleIndex = (currentRuleIndex + 1) % rules.size();
-            // cells = initializeCells(rows, cols); // Inicjalizacja nowych komórek
+    // Węzeł poziomu level, w którym wszystkie komórki mają stan value (0 - martwe, 1 - żywe)
+    uint32_t uniformNode(int level, int value) {
+        vector<uint32_t>& cache = uniformNodes[value];
+        while (int(cache.size()) <= level) {
+            int l = cache.size();
+            if (l < LEAF_LEVEL) cache.push_back(uint32_t(NO_NODE));
+            else if (l == LEAF_LEVEL) cache.push_back(leaf(value ? ~uint64_t(0) : 0));
+            else cache.push_back(join(cache[l - 1], cache[l - 1], cache[l - 1], cache[l - 1]));
+        }
+        return cache[level];
+    }
+
+    uint32_t emptyNode(int level) {
+        return uniformNode(level, 0);
+    }
+
+    // Stan węzła jednolitego (0 albo 1) albo -1, gdy węzeł ma oba stany
+    int uniformState(uint32_t id) const {
+        const Node& node = nodes[id];
+        if (node.population == 0) return 0;
+        if (node.level < 32 && node.population == uint64_t(1) << (2 * node.level)) return 1;
+        return -1;
+    }
+
+    // Stan jednolitego obszaru po 2^j pokoleniach. Pokolenie f zamienia martwy obszar na
+    // next[0], a żywy na next[511] (z B0 pusty obszar ożywa); dla każdego odwzorowania
+    // zbioru {0, 1} jest f^4 = f^2, więc dla j >= 1 wynikiem jest f(f(value))
+    int uniformAfter(int value, int j) const {
+        auto next = [&](int v) { return int(rule.next[v ? NEIGHBORHOOD_SIZE - 1 : 0]); };
+        return j == 0 ? next(value) : next(next(value));
+    }
+
+    // Komórka (i, j) kwadratu 16 x 16 złożonego z czterech liści
+    static int cellOf(const uint64_t quadrant[4], int i, int j) {
+        return (quadrant[(i / 8) * 2 + j / 8] >> ((i % 8) * 8 + j % 8)) & 1;
+    }
+
+    // Środkowe 8 x 8 węzła poziomu 4 po 2^j pokoleniach (j <= 2), liczone wprost z tablicy reguły
+    uint32_t baseStep(uint32_t id, int j) {
+        const Node& node = nodes[id];
+        uint64_t quadrant[4] = { nodes[node.nw].bits, nodes[node.ne].bits, nodes[node.sw].bits, nodes[node.se].bits };
+        uint8_t current[16][16], next[16][16];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 16; ++c) current[i][c] = cellOf(quadrant, i, c);
+        }
+
+        // Po t pokoleniach poprawny jest tylko obszar [t, 16 - t)
+        int generations = 1 << j;
+        for (int t = 1; t <= generations; ++t) {
+            for (int i = t; i < 16 - t; ++i) {
+                for (int c = t; c < 16 - t; ++c) {
+                    int index = 0;
+                    for (int x = -1; x <= 1; ++x) {
+                        for (int y = -1; y <= 1; ++y) index = (index << 1) | current[i + x][c + y];
+                    }
+                    next[i][c] = rule.next[index];
+                }
+            }
+            for (int i = t; i < 16 - t; ++i) {
+                for (int c = t; c < 16 - t; ++c) current[i][c] = next[i][c];
+            }
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            for (int c = 0; c < 8; ++c) bits |= uint64_t(current[i + 4][c + 4]) << (i * 8 + c);
+        }
+        return leaf(bits);
+    }
+
+    // Środkowy kwadrat węzła bez upływu czasu
+    uint32_t centerNode(uint32_t id) {
+        const Node& node = nodes[id];
+        if (node.level == LEAF_LEVEL + 1) {
+            uint64_t quadrant[4] = { nodes[node.nw].bits, nodes[node.ne].bits, nodes[node.sw].bits, nodes[node.se].bits };
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                for (int c = 0; c < 8; ++c) bits |= uint64_t(cellOf(quadrant, i + 4, c + 4)) << (i * 8 + c);
+            }
+            return leaf(bits);
+        }
+        return join(nodes[node.nw].se, nodes[node.ne].sw, nodes[node.sw].ne, nodes[node.se].nw);
+    }
+
+    // Wynik węzła poziomu k po 2^j pokoleniach (j <= k - 2)
+    uint32_t step(uint32_t id, int j) {
+        int level = nodes[id].level;
+        bool full = j == level - 2;
+        if (full && nodes[id].result != NO_NODE) return nodes[id].result;
+        int uniform = uniformState(id);
+        if (uniform >= 0) return uniformNode(level - 1, uniformAfter(uniform, j));
+
+        uint64_t key = (uint64_t(id) << 8) | uint64_t(j);
+        if (!full) {
+            auto found = stepMemo.find(key);
+            if (found != stepMemo.end()) return found->second;
+        }
+
+        if (nodes.size() > nodeLimit) throw BudgetExceeded();
+
+        uint32_t computed;
+        if (level == LEAF_LEVEL + 1) {
+            computed = baseStep(id, j);
+        }
+        else {
+            // Dziewięć nakładających się podwęzłów poziomu k - 1
+            Node n = nodes[id];
+            Node nw = nodes[n.nw], ne = nodes[n.ne], sw = nodes[n.sw], se = nodes[n.se];
+            uint32_t sub[9] = {
+                n.nw, join(nw.ne, ne.nw, nw.se, ne.sw), n.ne,
+                join(nw.sw, nw.se, sw.nw, sw.ne), join(nw.se, ne.sw, sw.ne, se.nw), join(ne.sw, ne.se, se.nw, se.ne),
+                n.sw, join(sw.ne, se.nw, sw.se, se.sw), n.se
+            };
+
+            // Pełny krok: połowa czasu w każdym etapie; krótszy krok: pierwszy etap bez upływu czasu
+            uint32_t r[9];
+            for (int s = 0; s < 9; ++s) r[s] = full ? step(sub[s], j - 1) : centerNode(sub[s]);
+            int secondStep = full ? j - 1 : j;
+            computed = join(
+                step(join(r[0], r[1], r[3], r[4]), secondStep), step(join(r[1], r[2], r[4], r[5]), secondStep),
+                step(join(r[3], r[4], r[6], r[7]), secondStep), step(join(r[4], r[5], r[7], r[8]), secondStep));
+        }
+
+        if (full) nodes[id].result = computed;
+        else stepMemo.emplace(key, computed);
+        return computed;
+    }
+
+    // Dodanie pustej ramki: węzeł poziomu k + 1 z dotychczasowym korzeniem pośrodku
+    void expand() {
+        Node r = nodes[root];
+        uint32_t empty = emptyNode(r.level - 1);
+        root = join(join(empty, empty, empty, r.nw), join(empty, empty, r.ne, empty),
+            join(empty, r.sw, empty, empty), join(r.se, empty, empty, empty));
+        int64_t half = int64_t(1) << (r.level - 1);
+        top -= half;
+        left -= half;
+    }
+
+    // Czy wszystkie żywe komórki leżą w środkowej ćwiartce (kwadrat 2^(k-2) pośrodku)
+    bool isCentered() {
+        const Node& r = nodes[root];
+        uint32_t inner = join(nodes[nodes[r.nw].se].se, nodes[nodes[r.ne].sw].sw,
+            nodes[nodes[r.sw].ne].ne, nodes[nodes[r.se].nw].nw);
+        return nodes[inner].population == nodes[root].population;
+    }
+
+    // Budżet węzłów; gdy sam bieżący stan jest duży, zostaje mu dwukrotny zapas
+    size_t nodeBudget() const {
+        return max(maxNodes, 2 * liveNodes);
+    }
+
+    // Krok węzła z limitem pamięci sprawdzanym w rekurencji: po przekroczeniu budżetu krok
+    // jest przerywany i zwracane jest false, a wywołujący czyści pamięć i powtarza krok albo
+    // dzieli go na dwa o połowę krótsze. Krok o jedno pokolenie (j == 0) liczony jest do końca
+    bool boundedStep(uint32_t id, int j, uint32_t& result) {
+        nodeLimit = j == 0 ? SIZE_MAX : nodeBudget();
+        try {
+            result = step(id, j);
+        }
+        catch (const BudgetExceeded&) {
+            nodeLimit = SIZE_MAX;
+            return false;
+        }
+        nodeLimit = SIZE_MAX;
+        return true;
+    }
+
+    // Krok płaszczyzny o 2^j pokoleń. Wzorzec w środkowej ćwiartce rośnie o najwyżej
+    // 2^j <= 2^(k-3) komórek, więc mieści się w wyniku i nie dotyka brzegu węzła. Krok
+    // przerwany przez budżet jest powtarzany po wyczyszczeniu pamięci, a jeśli nie mieści
+    // się nawet w czystej tablicy - dzielony na dwa kroki o 2^(j-1) pokoleń
+    void stepPlane(int j) {
+        bool fresh = nodes.size() == liveNodes;
+        while (nodes[root].level < j + 3 || nodes[root].level < LEAF_LEVEL + 3 || !isCentered()) expand();
+        int level = nodes[root].level;
+        uint32_t next;
+        if (!boundedStep(root, j, next)) {
+            root = collect(root);
+            if (fresh) {
+                stepPlane(j - 1);
+                stepPlane(j - 1);
+            }
+            else {
+                stepPlane(j);
+            }
+            return;
+        }
+        root = next;
+        int64_t quarter = int64_t(1) << (level - 2);
+        top += quarter;
+        left += quarter;
+        generation += uint64_t(1) << j;
+        collectIfOverBudget();
+    }
+
+    // Torus 2^k: węzeł z czterech kopii korzenia ma w środku cały torus przesunięty o 2^(k-1)
+    // w obu kierunkach, więc jego wynik to torus po 2^j pokoleniach z tym przesunięciem
+    // (środek węzła z czterech kopii wyniku je cofa). Pełne kroki o 2^(k-1) pokoleń są
+    // składane binarnie z zapamiętanych podwojeń, reszta to kroki o 2^j dla kolejnych bitów
+    void advanceTorus(uint64_t generations) {
+        int level = nodes[root].level;
+
+        uint64_t fullJumps = generations >> (level - 1);
+        for (int e = 0; fullJumps != 0; ++e, fullJumps >>= 1) {
+            if (fullJumps & 1) root = jumpTorus(root, e);
+            collectIfOverBudget();
+        }
+
+        for (int j = level - 2; j >= 0; --j) {
+            if ((generations >> j) & 1) {
+                root = stepTorus(root, j);
+                collectIfOverBudget();
+            }
+        }
+        generation += generations;
+    }
+
+    // Torus po 2^j pokoleniach (j <= k - 1) z limitem pamięci jak w stepPlane
+    uint32_t stepTorus(uint32_t id, int j) {
+        bool fresh = nodes.size() == liveNodes;
+        uint32_t next;
+        if (!boundedStep(join(id, id, id, id), j, next)) {
+            id = collect(id);
+            return fresh ? stepTorus(stepTorus(id, j - 1), j - 1) : stepTorus(id, j);
+        }
+        return centerNode(join(next, next, next, next));
+    }
+
+    // Torus po 2^e pełnych krokach o 2^(k-1) pokoleń. Po czyszczeniu pamięci w trakcie
+    // przeskoku identyfikator id jest nieaktualny - wynik nie jest wtedy zapamiętywany
+    uint32_t jumpTorus(uint32_t id, int e) {
+        if (e == 0) return stepTorus(id, nodes[id].level - 1);
+
+        uint64_t key = (uint64_t(id) << 8) | uint64_t(64 + e);
+        auto found = stepMemo.find(key);
+        if (found != stepMemo.end()) return found->second;
+
+        size_t collectionsBefore = collectionCount;
+        uint32_t jumped = jumpTorus(jumpTorus(id, e - 1), e - 1);
+        if (collectionCount == collectionsBefore) stepMemo.emplace(key, jumped);
+        return jumped;
+    }
+
+    uint32_t build(const CellGrid& cells, int row, int col, int level) {
+        if (level == LEAF_LEVEL) {
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                for (int j = 0; j < 8; ++j) {
+                    int r = row + i, c = col + j;
+                    if (r < int(cells.size()) && c < int(cells[0].size()) && cells[r][c]) bits |= uint64_t(1) << (i * 8 + j);
+                }
+            }
+            return leaf(bits);
+        }
+
+        int half = 1 << (level - 1);
+        if (row >= int(cells.size()) || col >= int(cells[0].size())) return emptyNode(level);
+        return join(build(cells, row, col, level - 1), build(cells, row, col + half, level - 1),
+            build(cells, row + half, col, level - 1), build(cells, row + half, col + half, level - 1));
+    }
+
+    template <class Visit>
+    void visitLive(uint32_t id, int64_t row, int64_t col, Visit& visit) const {
+        const Node& node = nodes[id];
+        if (node.population == 0) return;
+        if (node.level == LEAF_LEVEL) {
+            for (int b = 0; b < 64; ++b) {
+                if ((node.bits >> b) & 1) visit(row + b / 8, col + b % 8);
+            }
+            return;
+        }
+        int64_t half = int64_t(1) << (node.level - 1);
+        visitLive(node.nw, row, col, visit);
+        visitLive(node.ne, row, col + half, visit);
+        visitLive(node.sw, row + half, col, visit);
+        visitLive(node.se, row + half, col + half, visit);
+    }
+
+    // Czyszczenie pamięci: zostaje tylko drzewo węzła live (zwracany jest jego nowy
+    // identyfikator), a wszystkie zapamiętane wyniki są usuwane
+    uint32_t collect(uint32_t live) {
+        vector<Node> oldNodes;
+        oldNodes.swap(nodes);
+        clear();
+        ++collectionCount;
+        unordered_map<uint32_t, uint32_t> copied;
+        uint32_t copy = copyTree(oldNodes, live, copied);
+        liveNodes = nodes.size();
+        return copy;
+    }
+
+    void collectIfOverBudget() {
+        if (nodes.size() > nodeBudget()) root = collect(root);
+    }
+
+    uint32_t copyTree(const vector<Node>& oldNodes, uint32_t id, unordered_map<uint32_t, uint32_t>& copied) {
+        auto found = copied.find(id);
+        if (found != copied.end()) return found->second;
+
+        const Node& node = oldNodes[id];
+        uint32_t copy = node.level == LEAF_LEVEL
+            ? leaf(node.bits)
+            : join(copyTree(oldNodes, node.nw, copied), copyTree(oldNodes, node.ne, copied),
+                copyTree(oldNodes, node.sw, copied), copyTree(oldNodes, node.se, copied));
+        copied.emplace(id, copy);
+        return copy;
+    }
+
+    RuleTable rule;
+    HashLifeWorld world;
+    size_t maxNodes;
+    vector<Node> nodes;
+    unordered_map<uint64_t, uint32_t> leaves;
+    unordered_map<NodeKey, uint32_t, NodeKeyHash> joins;
+    unordered_map<uint64_t, uint32_t> stepMemo;  // Kroki krótsze niż pełne oraz przeskoki torusa
+    vector<uint32_t> uniformNodes[2];             // Węzły jednolite według poziomu: martwe i żywe
+    uint32_t root = NO_NODE;
+    int64_t top = 0;   // Współrzędne lewego górnego rogu korzenia na płaszczyźnie
+    int64_t left = 0;
+    uint64_t generation = 0;
+    size_t collectionCount = 0;
+    size_t liveNodes = 0;           // Rozmiar tablicy węzłów po ostatnim czyszczeniu
+    size_t nodeLimit = SIZE_MAX;    // Limit sprawdzany w step (tylko w boundedStep)
+};
+
+// Nieograniczony świat podzielony na fragmenty CHUNK_SIZE x CHUNK_SIZE komórek trzymane
+// w tablicy haszującej według współrzędnych fragmentu. Wiersz fragmentu to jedno słowo
+// (bit j = kolumna j), więc fragment liczony jest tym samym jądrem co siatka spakowana.
+// Fragment powstaje, gdy żywe komórki dochodzą do jego krawędzi, i znika, gdy w całości
+// wymrze - pamięć zależy od żywej zawartości, a nie od rozmiaru obszaru
+const int CHUNK_SIZE = 64;
+
+class ChunkedWorld {
+public:
+    explicit ChunkedWorld(const RuleTable& rule) {
+        setRule(rule);
+    }
+
+    void setRule(const RuleTable& newRule) {
+        if (newRule.next[0]) {
+            throw invalid_argument("Nieograniczony swiat nie obsluguje regul z B0");
+        }
+        rule = newRule;
+    }
+
+    int get(int64_t i, int64_t j) const {
+        auto found = chunks.find(chunkKey(chunkIndex(i), chunkIndex(j)));
+        if (found == chunks.end()) return 0;
+        return (found->second[cellOffset(i)] >> cellOffset(j)) & 1;
+    }
+
+    void set(int64_t i, int64_t j, int value) {
+        uint64_t key = chunkKey(chunkIndex(i), chunkIndex(j));
+        uint64_t bit = uint64_t(1) << cellOffset(j);
+        if (value) {
+            chunks[key][cellOffset(i)] |= bit;
+            return;
+        }
+        auto found = chunks.find(key);
+        if (found == chunks.end()) return;
+        found->second[cellOffset(i)] &= ~bit;
+        if (isEmpty(found->second)) chunks.erase(found);
+    }
+
+    // Wczytanie siatki tak, że komórka (i, j) trafia na współrzędne (top + i, left + j)
+    void load(const CellGrid& cells, int64_t top = 0, int64_t left = 0) {
+        chunks.clear();
+        generation = 0;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            for (size_t j = 0; j < cells[i].size(); ++j) {
+                if (cells[i][j]) set(top + int64_t(i), left + int64_t(j), 1);
+            }
+        }
+    }
+
+    void step() {
+        withKernel(rule, [&](const auto& kernel) {
+            stepWith(kernel);
+        });
+        ++generation;
+    }
+
+    // Wywołuje visit(i, j) dla każdej żywej komórki
+    template <class Visit>
+    void forEachLiveCell(Visit visit) const {
+        for (const auto& entry : chunks) {
+            int64_t top = int64_t(chunkRow(entry.first)) * CHUNK_SIZE;
+            int64_t left = int64_t(chunkCol(entry.first)) * CHUNK_SIZE;
+            for (int r = 0; r < CHUNK_SIZE; ++r) {
+                for (uint64_t bits = entry.second[r]; bits != 0; bits &= bits - 1) {
+                    visit(top + r, left + lowestBit(bits));
+                }
+            }
+        }
+    }
+
+    // Okno świata o rozmiarze view zaczynające się w (top, left); czytane są tylko
+    // fragmenty, które okno przecina
+    void copyViewport(PackedGrid& view, int64_t top, int64_t left) const {
+        fill(view.words.begin(), view.words.end(), 0);
+        for (int64_t cy = chunkIndex(top); cy <= chunkIndex(top + view.rows - 1); ++cy) {
+            for (int64_t cx = chunkIndex(left); cx <= chunkIndex(left + view.cols - 1); ++cx) {
+                auto found = chunks.find(chunkKey(cy, cx));
+                if (found == chunks.end()) continue;
+                for (int r = 0; r < CHUNK_SIZE; ++r) {
+                    int64_t i = cy * CHUNK_SIZE + r - top;
+                    if (i < 0 || i >= view.rows) continue;
+                    for (uint64_t bits = found->second[r]; bits != 0; bits &= bits - 1) {
+                        int64_t j = cx * CHUNK_SIZE + lowestBit(bits) - left;
+                        if (j >= 0 && j < view.cols) view.set(int(i), int(j), 1);
+                    }
+                }
+            }
+        }
+    }
+
+    // Prostokąt żywych komórek; false, gdy świat jest pusty
+    bool bounds(int64_t& top, int64_t& left, int64_t& bottom, int64_t& right) const {
+        bool any = false;
+        forEachLiveCell([&](int64_t i, int64_t j) {
+            if (!any) {
+                top = bottom = i;
+                left = right = j;
+                any = true;
+            }
+            top = min(top, i);
+            bottom = max(bottom, i);
+            left = min(left, j);
+            right = max(right, j);
+        });
+        return any;
+    }
+
+    uint64_t population() const {
+        uint64_t count = 0;
+        for (const auto& entry : chunks) {
+            for (uint64_t bits : entry.second) count += bitset<64>(bits).count();
+        }
+        return count;
+    }
+
+    size_t chunkCount() const { return chunks.size(); }
+    uint64_t generationCount() const { return generation; }
+
+private:
+    using Chunk = array<uint64_t, CHUNK_SIZE>;
+
+    // Dzielenie z zaokrągleniem w dół, także dla ujemnych współrzędnych
+    static int64_t chunkIndex(int64_t v) { return v >= 0 ? v / CHUNK_SIZE : -((-v - 1) / CHUNK_SIZE) - 1; }
+    static int cellOffset(int64_t v) { return int(v - chunkIndex(v) * CHUNK_SIZE); }
+
+    static uint64_t chunkKey(int64_t cy, int64_t cx) { return (uint64_t(uint32_t(cy)) << 32) | uint32_t(cx); }
+    static int32_t chunkRow(uint64_t key) { return int32_t(uint32_t(key >> 32)); }
+    static int32_t chunkCol(uint64_t key) { return int32_t(uint32_t(key)); }
+
+    static bool isEmpty(const Chunk& chunk) {
+        for (uint64_t bits : chunk) {
+            if (bits) return false;
+        }
+        return true;
+    }
+
+    struct KeyHash {
+        size_t operator()(uint64_t key) const {
+            key *= 0x9E3779B97F4A7C15ull;
+            return size_t(key ^ (key >> 29));
+        }
+    };
+
+    template <class Kernel>
+    void stepWith(const Kernel& kernel) {
+        // Do policzenia: istniejące fragmenty i sąsiedzi tych, których żywe komórki
+        // leżą przy wspólnej krawędzi lub w rogu
+        candidates.clear();
+        for (const auto& entry : chunks) {
+            int64_t cy = chunkRow(entry.first), cx = chunkCol(entry.first);
+            const Chunk& chunk = entry.second;
+            uint64_t columns = 0;
+            for (uint64_t bits : chunk) columns |= bits;
+            bool north = chunk[0] != 0, south = chunk[CHUNK_SIZE - 1] != 0;
+            bool west = columns & 1, east = columns >> 63;
+
+            candidates.push_back(entry.first);
+            if (north) candidates.push_back(chunkKey(cy - 1, cx));
+            if (south) candidates.push_back(chunkKey(cy + 1, cx));
+            if (west) candidates.push_back(chunkKey(cy, cx - 1));
+            if (east) candidates.push_back(chunkKey(cy, cx + 1));
+            if (chunk[0] & 1) candidates.push_back(chunkKey(cy - 1, cx - 1));
+            if (chunk[0] >> 63) candidates.push_back(chunkKey(cy - 1, cx + 1));
+            if (chunk[CHUNK_SIZE - 1] & 1) candidates.push_back(chunkKey(cy + 1, cx - 1));
+            if (chunk[CHUNK_SIZE - 1] >> 63) candidates.push_back(chunkKey(cy + 1, cx + 1));
+        }
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+        // Fragment z sąsiedztwem w układzie siatki spakowanej: wiersze -1..CHUNK_SIZE,
+        // w każdym słowo zachodniego sąsiada, słowo fragmentu i słowo wschodniego sąsiada
+        const int STRIDE = 3;
+        uint64_t local[(CHUNK_SIZE + 2) * STRIDE];
+        Chunk result;
+        nextChunks.clear();
+        for (uint64_t key : candidates) {
+            int64_t cy = chunkRow(key), cx = chunkCol(key);
+            for (int y = -1; y <= 1; ++y) {
+                for (int x = -1; x <= 1; ++x) {
+                    const Chunk* neighbor = find(cy + y, cx + x);
+                    // Z sąsiadów z góry i z dołu potrzebny jest tylko jeden wiersz
+                    int first = y < 0 ? CHUNK_SIZE - 1 : 0;
+                    int last = y == 0 ? CHUNK_SIZE - 1 : first;
+                    int target = y < 0 ? 0 : y == 0 ? 1 : CHUNK_SIZE + 1;
+                    for (int r = first; r <= last; ++r, ++target) {
+                        local[target * STRIDE + x + 1] = neighbor ? (*neighbor)[r] : 0;
+                    }
+                }
+            }
+
+            uint64_t any = 0;
+            for (int r = 0; r < CHUNK_SIZE; ++r) {
+                const uint64_t* up = local + r * STRIDE + 1;
+                result[r] = packedWord(up, up + STRIDE, up + 2 * STRIDE, 0, kernel);
+                any |= result[r];
+            }
+            if (any) nextChunks.emplace(key, result);
+        }
+        swap(chunks, nextChunks);
+    }
+
+    const Chunk* find(int64_t cy, int64_t cx) const {
+        auto found = chunks.find(chunkKey(cy, cx));
+        return found == chunks.end() ? nullptr : &found->second;
+    }
+
+    RuleTable rule;
+    unordered_map<uint64_t, Chunk, KeyHash> chunks;
+    unordered_map<uint64_t, Chunk, KeyHash> nextChunks;
+    vector<uint64_t> candidates;
+    uint64_t generation = 0;
+};
+
+// Zapis reguły: B/S dla reguł totalistycznych, MAP (base64 tablicy 512 bitów) dla pozostałych
+string formatRule(const RuleTable& rule) {
+    if (rule.isTotalistic) {
+        string text = "B";
+        for (int n = 0; n <= 8; ++n) {
+            if ((rule.life.birth >> n) & 1) text += char('0' + n);
+        }
+        text += "/S";
+        for (int n = 0; n <= 8; ++n) {
+            if ((rule.life.survive >> n) & 1) text += char('0' + n);
+        }
+        return text;
+    }
+
+    const string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string text = "MAP";
+    for (int first = 0; first < NEIGHBORHOOD_SIZE; first += 6) {
+        int value = 0;
+        for (int b = 0; b < 6; ++b) {
+            int index = first + b;
+            value = (value << 1) | (index < NEIGHBORHOOD_SIZE ? rule.next[index] : 0);
+        }
+        text += alphabet[value];
+    }
+    return text;
+}
+
+// Wzorzec wczytany z pliku; rule jest puste, jeśli plik jej nie podaje
+struct Pattern {
+    CellGrid cells;
+    string rule;
+};
+
+// Wczytanie wzorca w formacie RLE (nagłówek "x = ..., y = ..., rule = ...") albo
+// tekstowym (.cells: '.' martwa, 'O' lub '*' żywa, wiersze z '!' to komentarze)
+Pattern readPattern(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("Nie mozna otworzyc pliku: " + path);
+    }
+
+    vector<string> lines;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        lines.push_back(line);
+    }
+
+    Pattern pattern;
+    size_t header = 0;
+    while (header < lines.size() && (lines[header].empty() || lines[header][0] == '#')) ++header;
+    bool isRle = header < lines.size() && lines[header][0] == 'x' && lines[header].find('=') != string::npos;
+
+    if (!isRle) {
+        size_t width = 0;
+        for (const string& text : lines) {
+            if (!text.empty() && text[0] == '!') continue;
+            vector<int> row;
+            for (char c : text) row.push_back(c == 'O' || c == '*' ? 1 : 0);
+            width = max(width, row.size());
+            pattern.cells.push_back(row);
+        }
+        if (pattern.cells.empty() || width == 0) {
+            throw runtime_error("Pusty wzorzec: " + path);
+        }
+        for (vector<int>& row : pattern.cells) row.resize(width, 0);
+        return pattern;
+    }
+
+    // Nagłówek: pary klucz = wartość rozdzielone przecinkami
+    size_t width = 0, height = 0;
+    stringstream fields(lines[header]);
+    string field;
+    while (getline(fields, field, ',')) {
+        size_t equals = field.find('=');
+        if (equals == string::npos) continue;
+        string key = field.substr(0, equals), value = field.substr(equals + 1);
+        key.erase(remove(key.begin(), key.end(), ' '), key.end());
+        value.erase(remove(value.begin(), value.end(), ' '), value.end());
+        if (key == "x") width = stoul(value);
+        else if (key == "y") height = stoul(value);
+        else if (key == "rule") pattern.rule = value;
+    }
+
+    // Treść: [liczba]b - martwe, [liczba]o (lub inna litera) - żywe, [liczba]$ - koniec wiersza, ! - koniec
+    pattern.cells.assign(max<size_t>(height, 1), vector<int>());
+    size_t row = 0;
+    size_t count = 0;
+    bool finished = false;
+    for (size_t l = header + 1; l < lines.size() && !finished; ++l) {
+        for (char c : lines[l]) {
+            if (c >= '0' && c <= '9') {
+                count = count * 10 + (c - '0');
+                continue;
+            }
+            size_t run = count == 0 ? 1 : count;
+            count = 0;
+            if (c == '!') {
+                finished = true;
+                break;
+            }
+            else if (c == '$') {
+                row += run;
+            }
+            else if (c == 'b' || c == '.') {
+                if (row >= pattern.cells.size()) pattern.cells.resize(row + 1);
+                pattern.cells[row].insert(pattern.cells[row].end(), run, 0);
+            }
+            else if (isalpha(static_cast<unsigned char>(c))) {
+                if (row >= pattern.cells.size()) pattern.cells.resize(row + 1);
+                pattern.cells[row].insert(pattern.cells[row].end(), run, 1);
+            }
+        }
+    }
+
+    for (const vector<int>& cells : pattern.cells) width = max(width, cells.size());
+    if (width == 0) {
+        throw runtime_error("Pusty wzorzec: " + path);
+    }
+    for (vector<int>& cells : pattern.cells) cells.resize(width, 0);
+    return pattern;
+}
+
+// Umieszczenie wzorca w centrum macierzy (jak placeGlider)
+void placePattern(CellGrid& grid, const CellGrid& pattern) {
+    int rows = grid.size();
+    int cols = grid[0].size();
+    int height = pattern.size();
+    int width = pattern[0].size();
+    if (height > rows || width > cols) {
+        throw invalid_argument("Wzorzec " + to_string(height) + "x" + to_string(width) + " nie miesci sie w siatce");
+    }
+
+    int startRow = (rows - height) / 2;
+    int startCol = (cols - width) / 2;
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            grid[startRow + i][startCol + j] = pattern[i][j];
+        }
+    }
+}
+
+// Zapis żywych komórek (wiersz, kolumna) jako RLE; wzorzec zaczyna się w rogu ich prostokąta
+void writeRle(const string& path, vector<pair<int64_t, int64_t>> cells, const RuleTable& rule) {
+    ofstream out(path);
+    if (!out) {
+        throw runtime_error("Nie mozna zapisac pliku: " + path);
+    }
+
+    sort(cells.begin(), cells.end());
+    int64_t minRow = 0, maxRow = -1, minCol = 0, maxCol = -1;
+    if (!cells.empty()) {
+        minRow = cells.front().first;
+        maxRow = cells.back().first;
+        minCol = cells.front().second;
+        maxCol = cells.front().second;
+        for (const auto& cell : cells) {
+            minCol = min(minCol, cell.second);
+            maxCol = max(maxCol, cell.second);
+        }
+    }
+    out << "x = " << maxCol - minCol + 1 << ", y = " << maxRow - minRow + 1 << ", rule = " << formatRule(rule) << "\n";
+
+    // Wiersze treści nie dłuższe niż 70 znaków
+    string line;
+    auto emit = [&](int64_t count, char tag) {
+        string token = (count > 1 ? to_string(count) : string()) + tag;
+        if (line.size() + token.size() > 70) {
+            out << line << "\n";
+            line.clear();
+        }
+        line += token;
+    };
+
+    int64_t row = minRow, col = minCol;
+    for (size_t k = 0; k < cells.size();) {
+        int64_t r = cells[k].first, c = cells[k].second;
+        if (r > row) {
+            emit(r - row, '$');
+            row = r;
+            col = minCol;
+        }
+        if (c > col) emit(c - col, 'b');
+
+        size_t run = 1;
+        while (k + run < cells.size() && cells[k + run].first == r && cells[k + run].second == c + int64_t(run)) ++run;
+        emit(run, 'o');
+        col = c + run;
+        k += run;
+    }
+    emit(1, '!');
+    out << line << "\n";
+}
+
+vector<pair<int64_t, int64_t>> liveCells(const PackedGrid& grid) {
+    vector<pair<int64_t, int64_t>> cells;
+    for (int i = 0; i < grid.rows; ++i) {
+        for (int j = 0; j < grid.cols; ++j) {
+            if (grid.get(i, j)) cells.emplace_back(i, j);
+        }
+    }
+    return cells;
+}
+
+uint64_t population(const PackedGrid& grid) {
+    uint64_t count = 0;
+    for (int i = 0; i < grid.rows; ++i) {
+        const uint64_t* row = grid.row(i);
+        for (size_t w = 0; w < grid.wordsPerRow; ++w) count += bitset<64>(row[w]).count();
+    }
+    return count;
+}
+
+// Punkt kontrolny: nagłówek stałej długości, a po nim wiersze siatki spakowanej
+// (bez ramki, wordsPerRow słów na wiersz). Reguła zapisana jest jako pełna tablica
+// 512 przejść, więc plik odtwarza także reguły spoza rodziny B/S
+const char CHECKPOINT_MAGIC[8] = { 'L', 'I', 'F', 'E', 'C', 'K', 'P', '1' };
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t boundary;
+    uint32_t reserved;
+    uint64_t generation;
+    uint64_t seed;        // Ziarno CounterRng - licznikowy generator nie ma innego stanu
+    uint8_t rule[NEIGHBORHOOD_SIZE];
+    uint8_t padding[24];  // Dopełnienie do 576 bajtów, słowa siatki wyrównane do 64 bajtów
+};
+static_assert(sizeof(CheckpointHeader) == 576, "Nieoczekiwany rozmiar naglowka punktu kontrolnego");
+
+// Stan przebiegu poza samą siatką
+struct CheckpointInfo {
+    RuleTable rule;
+    Boundary boundary = Boundary::Periodic;
+    uint64_t generation = 0;
+    uint64_t seed = 0;
+};
+
+// Plik zmapowany do pamięci tylko do odczytu
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw runtime_error("Nie mozna otworzyc pliku: " + path);
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = size_t(fileSize.QuadPart);
+        if (length > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!view) {
+                release();
+                throw runtime_error("Nie mozna zmapowac pliku: " + path);
+            }
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Nie mozna otworzyc pliku: " + path);
+        }
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0) {
+            length = size_t(status.st_size);
+            view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) view = nullptr;
+            else madvise(view, length, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        if (length > 0 && !view) {
+            throw runtime_error("Nie mozna zmapowac pliku: " + path);
+        }
+#endif
+    }
+
+    ~MappedFile() { release(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return static_cast<const unsigned char*>(view); }
+    size_t size() const { return length; }
+
+private:
+    void release() {
+#ifdef _WIN32
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view) munmap(view, length);
+#endif
+        view = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+    void* view = nullptr;
+    size_t length = 0;
+};
+
+// Odtworzenie siatki i stanu przebiegu z punktu kontrolnego. Plik jest mapowany,
+// więc wiersze kopiowane są prosto ze stron pamięci podręcznej systemu
+PackedGrid readCheckpoint(const string& path, CheckpointInfo& info) {
+    MappedFile file(path);
+    CheckpointHeader header;
+    if (file.size() < sizeof(header)) {
+        throw runtime_error("Uszkodzony punkt kontrolny: " + path);
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0
+        || header.rows == 0 || header.cols == 0 || header.boundary > uint32_t(Boundary::FixedAlive)) {
+        throw runtime_error("To nie jest punkt kontrolny: " + path);
+    }
+
+    PackedGrid grid(int(header.rows), int(header.cols));
+    size_t rowBytes = grid.wordsPerRow * sizeof(uint64_t);
+    if (file.size() != sizeof(header) + size_t(grid.rows) * rowBytes) {
+        throw runtime_error("Uszkodzony punkt kontrolny: " + path);
+    }
+    const unsigned char* source = file.data() + sizeof(header);
+    for (int i = 0; i < grid.rows; ++i) {
+        memcpy(grid.row(i), source + size_t(i) * rowBytes, rowBytes);
+    }
+
+    array<uint8_t, NEIGHBORHOOD_SIZE> next;
+    for (int index = 0; index < NEIGHBORHOOD_SIZE; ++index) next[index] = header.rule[index] & 1;
+    info.rule = compileRule(next);
+    info.boundary = Boundary(header.boundary);
+    info.generation = header.generation;
+    info.seed = header.seed;
+    return grid;
+}
+
+// Zapis punktów kontrolnych w tle. save() robi tylko migawkę (kopię wierszy siatki,
+// tańszą niż jeden krok), a zapis na dysk odbywa się w osobnym wątku, więc przebieg
+// liczy dalej. Plik powstaje pod nazwą tymczasową i jest podmieniany dopiero po
+// zapisaniu całości - przerwany zapis nie niszczy poprzedniego punktu kontrolnego
+class CheckpointWriter {
+public:
+    CheckpointWriter() : writer(&CheckpointWriter::writerLoop, this) {}
+
+    ~CheckpointWriter() {
+        {
+            lock_guard<mutex> lock(m);
+            finished = true;
+        }
+        cv.notify_all();
+        writer.join();
+    }
+
+    // Czeka tylko wtedy, gdy poprzedni punkt kontrolny jeszcze się zapisuje
+    void save(const string& path, const PackedGrid& grid, const CheckpointInfo& info) {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this] { return !hasPending; });
+        rethrowError();
+
+        CheckpointHeader& header = pending.header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        header.rows = uint32_t(grid.rows);
+        header.cols = uint32_t(grid.cols);
+        header.boundary = uint32_t(info.boundary);
+        header.generation = info.generation;
+        header.seed = info.seed;
+        copy(info.rule.next.begin(), info.rule.next.end(), header.rule);
+
+        pending.path = path;
+        pending.words.resize(size_t(grid.rows) * grid.wordsPerRow);
+        for (int i = 0; i < grid.rows; ++i) {
+            copy(grid.row(i), grid.row(i) + grid.wordsPerRow, pending.words.begin() + size_t(i) * grid.wordsPerRow);
+        }
+        hasPending = true;
+        lock.unlock();
+        cv.notify_all();
+    }
+
+    // Czeka na zapisanie ostatniego punktu kontrolnego; błąd zapisu jest zgłaszany tutaj
+    void wait() {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [this] { return !hasPending && !isWriting; });
+        rethrowError();
+    }
+
+private:
+    struct Snapshot {
+        string path;
+        CheckpointHeader header;
+        vector<uint64_t> words;
+    };
+
+    void writerLoop() {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            cv.wait(lock, [this] { return hasPending || finished; });
+            if (!hasPending) return;
+
+            // Migawka przechodzi do wątku zapisu, a bufor wraca do save() na następny raz
+            swap(pending, inFlight);
+            hasPending = false;
+            isWriting = true;
+            cv.notify_all();
+            lock.unlock();
+
+            string failure;
+            try {
+                writeFile(inFlight);
+            }
+            catch (const exception& e) {
+                failure = e.what();
+            }
+
+            lock.lock();
+            isWriting = false;
+            if (!failure.empty() && error.empty()) error = failure;
+            cv.notify_all();
+        }
+    }
+
+    static void writeFile(const Snapshot& snapshot) {
+        string temporary = snapshot.path + ".tmp";
+        {
+            ofstream out(temporary, ios::binary | ios::trunc);
+            if (!out) {
+                throw runtime_error("Nie mozna zapisac pliku: " + temporary);
+            }
+            out.write(reinterpret_cast<const char*>(&snapshot.header), sizeof(snapshot.header));
+            out.write(reinterpret_cast<const char*>(snapshot.words.data()), snapshot.words.size() * sizeof(uint64_t));
+            if (!out.flush()) {
+                throw runtime_error("Blad zapisu pliku: " + temporary);
+            }
+        }
+#ifdef _WIN32
+        // rename nie nadpisuje istniejącego pliku pod Windows
+        if (!MoveFileExA(temporary.c_str(), snapshot.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+        if (rename(temporary.c_str(), snapshot.path.c_str()) != 0) {
+#endif
+            throw runtime_error("Nie mozna zapisac pliku: " + snapshot.path);
+        }
+    }
+
+    void rethrowError() {
+        if (!error.empty()) {
+            string message;
+            swap(message, error);
+            throw runtime_error(message);
+        }
+    }
+
+    mutex m;
+    condition_variable cv;
+    Snapshot pending;
+    Snapshot inFlight;
+    bool hasPending = false;
+    bool isWriting = false;
+    bool finished = false;
+    string error;
+    thread writer;
+};
+
+// Statystyki jednego pokolenia w kolejce do zapisu
+struct GenerationStats {
+    uint64_t generation = 0;
+    uint64_t population = 0;
+    BlockStats stats;
+};
+
+// Kolejka jednego producenta i jednego konsumenta bez blokad: producent (krok symulacji)
+// przesuwa tylko head, konsument (zapis) tylko tail. Pojemność jest potęgą dwójki, więc
+// numer miejsca to licznik & mask
+class StatsRing {
+public:
+    explicit StatsRing(size_t capacity = 4096) : slots(capacity), mask(capacity - 1) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw invalid_argument("Pojemnosc kolejki musi byc potega dwojki");
+        }
+    }
+
+    bool tryPush(const GenerationStats& item) {
+        size_t position = head.load(memory_order_relaxed);
+        if (position - tail.load(memory_order_acquire) == slots.size()) return false;
+        slots[position & mask] = item;
+        head.store(position + 1, memory_order_release);
+        return true;
+    }
+
+    // Przy pełnej kolejce producent czeka na konsumenta - rekordy nie giną
+    void push(const GenerationStats& item) {
+        for (int spin = 0; !tryPush(item); ++spin) {
+            if (spin > 64) this_thread::yield();
+        }
+    }
+
+    bool tryPop(GenerationStats& item) {
+        size_t position = tail.load(memory_order_relaxed);
+        if (position == head.load(memory_order_acquire)) return false;
+        item = slots[position & mask];
+        tail.store(position + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    vector<GenerationStats> slots;
+    size_t mask;
+    atomic<size_t> head{ 0 };
+    char padding[64]; // head i tail w osobnych liniach pamięci podręcznej
+    atomic<size_t> tail{ 0 };
+};
+
+// Zapis statystyk pokoleń jako CSV do pliku albo na standardowe wyjście ("-"). Krok
+// symulacji tylko wstawia rekord do kolejki, a formatowaniem i zapisem zajmuje się
+// osobny wątek
+class StatsSink {
+public:
+    explicit StatsSink(const string& path) {
+        if (path != "-") {
+            file.open(path, ios::trunc);
+            if (!file) {
+                throw runtime_error("Nie mozna zapisac pliku: " + path);
+            }
+        }
+        out = path == "-" ? &cout : &file;
+        *out << "pokolenie,populacja,narodziny,smierci,wiersz_min,wiersz_max,kolumna_min,kolumna_max\n";
+        writer = thread(&StatsSink::drainLoop, this);
+    }
+
+    // Czeka na zapisanie wszystkich rekordów
+    ~StatsSink() {
+        finished.store(true, memory_order_release);
+        writer.join();
+    }
+
+    StatsSink(const StatsSink&) = delete;
+    StatsSink& operator=(const StatsSink&) = delete;
+
+    void publish(uint64_t generation, uint64_t population, const BlockStats& stats) {
+        GenerationStats item;
+        item.generation = generation;
+        item.population = population;
+        item.stats = stats;
+        ring.push(item);
+    }
+
+private:
+    void drainLoop() {
+        GenerationStats item;
+        while (true) {
+            bool stopping = finished.load(memory_order_acquire);
+            bool any = false;
+            while (ring.tryPop(item)) {
+                write(item);
+                any = true;
+            }
+            if (stopping) break;
+            if (!any) this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        out->flush();
+    }
+
+    // Pusty prostokąt (brak żywych komórek) zapisywany jest jako puste pola
+    void write(const GenerationStats& item) {
+        const BlockStats& stats = item.stats;
+        *out << item.generation << ',' << item.population << ',' << stats.births << ',' << stats.deaths;
+        if (stats.maxRow >= 0) {
+            *out << ',' << stats.minRow << ',' << stats.maxRow << ',' << stats.minCol() << ',' << stats.maxCol() << '\n';
+        }
+        else {
+            *out << ",,,,\n";
+        }
+    }
+
+    StatsRing ring;
+    ofstream file;
+    ostream* out = nullptr;
+    atomic<bool> finished{ false };
+    thread writer;
+};
+
+const int CELL_SIZE = 5; // Rozmiar pojedynczej komórki w pikselach
+
+// Rysowanie siatki spakowanej jako jednej tekstury: komórki rozwijane są do bufora
+// pikseli (piksel na komórkę), tekstura jest aktualizowana raz na klatkę, a sprite
+// powiększa ją na karcie graficznej - jedno wywołanie draw zamiast jednego na komórkę
+class GridRenderer {
+public:
+    GridRenderer(int rows, int cols, int cellSize = CELL_SIZE)
+        : rows(rows), cols(cols), pixels(size_t(rows) * cols * 4) {
+        if (!texture.create(cols, rows)) {
+            throw runtime_error("Nie udalo sie utworzyc tekstury");
+        }
+        sprite.setTexture(texture);
+        sprite.setScale(float(cellSize), float(cellSize));
+    }
+
+    void draw(sf::RenderWindow& window, const PackedGrid& grid) {
+        const sf::Color colors[2] = { sf::Color::Black, sf::Color::Green }; // Martwa, żywa
+        sf::Uint8* pixel = pixels.data();
+        for (int i = 0; i < rows; ++i) {
+            const uint64_t* row = grid.row(i);
+            for (int j = 0; j < cols; ++j, pixel += 4) {
+                const sf::Color& color = colors[(row[j / 64] >> (j % 64)) & 1];
+                pixel[0] = color.r;
+                pixel[1] = color.g;
+                pixel[2] = color.b;
+                pixel[3] = color.a;
+            }
+        }
+        texture.update(pixels.data());
+        window.draw(sprite);
+    }
+
+private:
+    int rows;
+    int cols;
+    vector<sf::Uint8> pixels; // RGBA
+    sf::Texture texture;
+    sf::Sprite sprite;
+};
+
+void updateWindowTitle(sf::RenderWindow& window, const string& rule) {
+    window.setTitle("Regula: " + rule);
+}
+
+// Ustawienia uruchomienia (okno albo tryb bez okna)
+struct RunOptions {
+    bool headless = false;
+    string patternFile;             // Pusty - glider (okno) albo losowa zupa (bez okna)
+    string outFile;                 // Pusty - bez zapisu stanu końcowego
+    string rule;                    // Pusty - reguła z pliku RLE albo domyślna
+    int rows = 0;                   // 0 - rozmiar domyślny
+    int cols = 0;
+    uint64_t generations = 1000;
+    Boundary boundary = Boundary::Periodic;
+    string engine = "tiles";        // tiles, packed, hashlife albo chunked (świat nieograniczony)
+    unsigned threads = 1;           // Więcej niż 1 (lub 0 = wszystkie rdzenie) - krok równoległy
+    bool plane = false;             // HashLife na nieskończonej płaszczyźnie zamiast torusa
+    size_t memoryBudgetMB = 256;    // Budżet pamięci HashLife
+    double density = 0.5;           // Gęstość losowej zupy
+    uint64_t seed = 2024;
+    int generationsPerFrame = 1;    // Pokolenia liczone między kolejnymi klatkami (okno)
+    string checkpointFile;          // Pusty - bez punktów kontrolnych
+    uint64_t checkpointEvery = 0;   // 0 - punkt kontrolny tylko na końcu przebiegu
+    string restoreFile;             // Pusty - start od wzorca albo losowej zupy
+    string statsFile;               // Statystyki pokoleń jako CSV ("-" - standardowe wyjście)
+    bool verify = false;            // Porównanie stanu końcowego z silnikiem odniesienia
+};
+
+// Siatka startowa: wzorzec z pliku w centrum albo losowa zupa; reguła z opcji, z pliku
+// albo B3/S23
+CellGrid initialCells(RunOptions& options, RuleTable& rule) {
+    Pattern pattern;
+    if (!options.patternFile.empty()) {
+        pattern = readPattern(options.patternFile);
+    }
+    string ruleText = !options.rule.empty() ? options.rule : !pattern.rule.empty() ? pattern.rule : "B3/S23";
+    rule = parseRule(ruleText);
+
+    int minimum = 200;
+    if (options.engine == "hashlife" && !options.plane) {
+        minimum = 256; // Torus HashLife wymaga boku 2^k
+    }
+    if (options.rows == 0) options.rows = max<int>(minimum, pattern.cells.size());
+    if (options.cols == 0) options.cols = max<int>(minimum, pattern.cells.empty() ? 0 : pattern.cells[0].size());
+
+    if (pattern.cells.empty()) {
+        return initializeRandomCells(options.rows, options.cols, options.density, options.seed);
+    }
+    CellGrid cells = initializeGrid(options.rows, options.cols);
+    placePattern(cells, pattern.cells);
+    return cells;
+}
+
+// Żywe komórki silnika odniesienia dla --verify po generations pokoleniach od stanu start:
+// dla siatki i torusa HashLife prosty krok spakowany z tym samym brzegiem, a płaszczyzna
+// HashLife i świat nieograniczony sprawdzają się nawzajem
+vector<pair<int64_t, int64_t>> referenceCells(const PackedGrid& start, const RuleTable& rule, const RunOptions& options,
+    uint64_t generations) {
+    bool unbounded = options.engine == "chunked" || (options.engine == "hashlife" && options.plane);
+    if (!unbounded) {
+        PackedGrid grid = start;
+        PackedGrid nextGrid(start.rows, start.cols);
+        for (uint64_t generation = 0; generation < generations; ++generation) {
+            updatePackedCells(grid, nextGrid, rule, options.boundary);
+            swap(grid, nextGrid);
+        }
+        return liveCells(grid);
+    }
+
+    CellGrid cells = initializeGrid(start.rows, start.cols);
+    unpackGrid(start, cells);
+    vector<pair<int64_t, int64_t>> live;
+    if (options.engine == "chunked") {
+        HashLife2D hashLife(rule, HashLifeWorld::Plane);
+        hashLife.load(cells);
+        hashLife.advance(generations);
+        hashLife.forEachLiveCell([&](int64_t i, int64_t j) { live.emplace_back(i, j); });
+    }
+    else {
+        ChunkedWorld world(rule);
+        world.load(cells);
+        for (uint64_t generation = 0; generation < generations; ++generation) world.step();
+        world.forEachLiveCell([&](int64_t i, int64_t j) { live.emplace_back(i, j); });
+    }
+    return live;
+}
+
+// Tryb bez okna: N pokoleń wybranym silnikiem, czas i przepustowość na standardowe wyjście,
+// stan końcowy opcjonalnie do pliku RLE
+int runHeadless(RunOptions options) {
+    RuleTable rule;
+    PackedGrid grid;
+    uint64_t generation = 0;
+    if (!options.restoreFile.empty()) {
+        // Wznowienie: reguła, brzeg, ziarno i licznik pokoleń pochodzą z punktu kontrolnego,
+        // --generations pozostaje docelowym numerem pokolenia
+        CheckpointInfo info;
+        grid = readCheckpoint(options.restoreFile, info);
+        rule = info.rule;
+        options.boundary = info.boundary;
+        options.seed = info.seed;
+        options.rows = grid.rows;
+        options.cols = grid.cols;
+        generation = min(info.generation, options.generations);
+        cout << "Wznowiono: " << options.restoreFile << ", pokolenie " << info.generation << endl;
+    }
+    else {
+        grid = packGrid(initialCells(options, rule));
+    }
+    int rows = options.rows, cols = options.cols;
+    uint64_t firstGeneration = generation;
+    PackedGrid startGrid;
+    if (options.verify) startGrid = grid;
+    bool keepCells = !options.outFile.empty() || options.verify;
+    vector<pair<int64_t, int64_t>> finalCells;
+    uint64_t finalPopulation = 0;
+
+    bool isGridEngine = options.engine == "tiles" || options.engine == "packed";
+    if (!isGridEngine && !options.checkpointFile.empty()) {
+        throw invalid_argument("Punkty kontrolne zapisuja tylko silniki tiles i packed");
+    }
+    if (!isGridEngine && !options.statsFile.empty()) {
+        throw invalid_argument("Statystyki pokolen zbieraja tylko silniki tiles i packed");
+    }
+
+    auto start = chrono::steady_clock::now();
+    if (options.engine == "hashlife") {
+        if (!options.plane && options.boundary != Boundary::Periodic) {
+            throw invalid_argument("HashLife obsluguje torus (warunek periodyczny) albo plaszczyzne (--plane)");
+        }
+        CellGrid cells = initializeGrid(rows, cols);
+        unpackGrid(grid, cells);
+        HashLife2D hashLife(rule, options.plane ? HashLifeWorld::Plane : HashLifeWorld::Torus, options.memoryBudgetMB << 20);
+        hashLife.load(cells);
+        hashLife.advance(options.generations - generation);
+        generation = options.generations;
+        finalPopulation = hashLife.population();
+        cout << "Wezly: " << hashLife.nodeCount() << ", czyszczenia pamieci: " << hashLife.collections() << endl;
+        if (keepCells) {
+            hashLife.forEachLiveCell([&](int64_t i, int64_t j) { finalCells.emplace_back(i, j); });
+        }
+    }
+    else if (options.engine == "chunked") {
+        // Siatka startowa trafia w róg (0, 0) świata bez brzegów; --boundary nie ma znaczenia
+        CellGrid cells = initializeGrid(rows, cols);
+        unpackGrid(grid, cells);
+        ChunkedWorld world(rule);
+        world.load(cells);
+        for (; generation < options.generations; ++generation) world.step();
+        finalPopulation = world.population();
+        if (keepCells) {
+            world.forEachLiveCell([&](int64_t i, int64_t j) { finalCells.emplace_back(i, j); });
+        }
+        cout << "Fragmenty " << CHUNK_SIZE << "x" << CHUNK_SIZE << ": " << world.chunkCount() << endl;
+    }
+    else if (isGridEngine) {
+        PackedGrid nextGrid(rows, cols);
+        CheckpointWriter checkpoints;
+        auto checkpoint = [&] {
+            CheckpointInfo info;
+            info.rule = rule;
+            info.boundary = options.boundary;
+            info.generation = generation;
+            info.seed = options.seed;
+            checkpoints.save(options.checkpointFile, grid, info);
+        };
+
+        // Pokolenia liczone odcinkami kończącymi się na kolejnych punktach kontrolnych
+        uint64_t every = options.checkpointFile.empty() ? 0 : options.checkpointEvery;
+        auto runSegments = [&](auto advanceBy) {
+            while (generation < options.generations) {
+                uint64_t count = options.generations - generation;
+                if (every > 0) count = min(count, every - generation % every);
+                advanceBy(count);
+                generation += count;
+                if (every > 0 && generation % every == 0 && generation < options.generations) checkpoint();
+            }
+        };
+
+        // Statystyki zbiera sam krok; tutaj populacja jest tylko przesuwana o narodziny
+        // i śmierci (pełne zliczenie raz, na starcie), a rekord trafia do zapisu w tle
+        unique_ptr<StatsSink> statsSink;
+        uint64_t observed = generation;
+        uint64_t livePopulation = 0;
+        function<void(const BlockStats&)> observe;
+        if (!options.statsFile.empty()) {
+            statsSink.reset(new StatsSink(options.statsFile));
+            livePopulation = population(grid);
+            observe = [&](const BlockStats& stats) {
+                livePopulation += stats.births;
+                livePopulation -= stats.deaths;
+                statsSink->publish(++observed, livePopulation, stats);
+            };
+        }
+
+        if (options.threads != 1) {
+            ParallelLifeStepper parallel(options.threads);
+            runSegments([&](uint64_t count) {
+                for (uint64_t done = 0; done < count;) {
+                    int chunk = int(min<uint64_t>(count - done, 1 << 30));
+                    parallel.advance(grid, nextGrid, rule, options.boundary, chunk, observe);
+                    done += chunk;
+                }
+            });
+        }
+        else if (options.engine == "tiles") {
+            TileActivity activity(grid);
+            BlockStats stats;
+            runSegments([&](uint64_t count) {
+                for (uint64_t step = 0; step < count; ++step) {
+                    if (statsSink) {
+                        updateActiveTiles(grid, nextGrid, rule, options.boundary, activity, stats);
+                        observe(stats);
+                    }
+                    else {
+                        updateActiveTiles(grid, nextGrid, rule, options.boundary, activity);
+                    }
+                    swap(grid, nextGrid);
+                }
+            });
+        }
+        else {
+            BlockStats stats;
+            runSegments([&](uint64_t count) {
+                for (uint64_t step = 0; step < count; ++step) {
+                    if (statsSink) {
+                        updatePackedCells(grid, nextGrid, rule, options.boundary, stats);
+                        observe(stats);
+                    }
+                    else {
+                        updatePackedCells(grid, nextGrid, rule, options.boundary);
+                    }
+                    swap(grid, nextGrid);
+                }
+            });
+        }
+        statsSink.reset();
+        if (!options.checkpointFile.empty()) {
+            checkpoint();
+            checkpoints.wait();
+        }
+        finalPopulation = population(grid);
+        if (keepCells) finalCells = liveCells(grid);
+    }
+    else {
+        throw invalid_argument("Nieznany silnik: " + options.engine);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Regula: " << formatRule(rule) << endl;
+    cout << "Siatka: " << rows << "x" << cols << ", silnik: " << options.engine
+        << (options.threads != 1 && options.engine != "hashlife" ? " (rownolegle)" : "") << endl;
+    cout << "Pokolenia: " << generation << ", populacja: " << finalPopulation << endl;
+    cout << "Czas: " << fixed << setprecision(3) << seconds << " s" << endl;
+    if (seconds > 0 && !(options.engine == "hashlife" && options.plane)) { // Płaszczyzna nie ma rozmiaru
+        cout << "Komorki/s: " << scientific << setprecision(3)
+            << double(rows) * double(cols) * double(generation - firstGeneration) / seconds << endl;
+    }
+
+    if (options.verify) {
+        vector<pair<int64_t, int64_t>> expected = referenceCells(startGrid, rule, options, generation - firstGeneration);
+        sort(expected.begin(), expected.end());
+        sort(finalCells.begin(), finalCells.end());
+        if (expected != finalCells) {
+            throw runtime_error("Silnik " + options.engine + " i silnik odniesienia daja rozne wyniki");
+        }
+        cout << "Zgodne z silnikiem odniesienia" << endl;
+    }
+
+    if (!options.outFile.empty()) {
+        writeRle(options.outFile, finalCells, rule);
+        cout << "Zapisano: " << options.outFile << endl;
+    }
+    if (!options.checkpointFile.empty()) {
+        cout << "Punkt kontrolny: " << options.checkpointFile << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int steps = 20; 
+    vector<int> rules = { 40, 63, 26, 190 }; 
+    int currentRuleIndex = 0; 
+    RunOptions options;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--headless") {
+                options.headless = true;
+            }
+            else if (arg == "--plane") {
+                options.plane = true;
+            }
+            else if (arg == "--pattern" && hasValue) {
+                options.patternFile = argv[++i];
+            }
+            else if (arg == "--out" && hasValue) {
+                options.outFile = argv[++i];
+            }
+            else if (arg == "--rule" && hasValue) {
+                options.rule = argv[++i];
+            }
+            else if (arg == "--rows" && hasValue) {
+                options.rows = stoi(argv[++i]);
+            }
+            else if (arg == "--cols" && hasValue) {
+                options.cols = stoi(argv[++i]);
+            }
+            else if (arg == "--generations" && hasValue) {
+                options.generations = stoull(argv[++i]);
+            }
+            else if (arg == "--engine" && hasValue) {
+                options.engine = argv[++i];
+            }
+            else if (arg == "--memory" && hasValue) {
+                options.memoryBudgetMB = stoull(argv[++i]);
+            }
+            else if (arg == "--density" && hasValue) {
+                options.density = stod(argv[++i]);
+            }
+            else if (arg == "--seed" && hasValue) {
+                options.seed = stoull(argv[++i]);
+            }
+            else if (arg == "--generations-per-frame" && hasValue) {
+                options.generationsPerFrame = stoi(argv[++i]);
+            }
+            else if (arg == "--boundary" && hasValue) {
+                options.boundary = parseBoundary(argv[++i]);
+            }
+            else if (arg == "--threads" && hasValue) {
+                options.threads = stoul(argv[++i]);
+            }
+            else if (arg == "--checkpoint" && hasValue) {
+                options.checkpointFile = argv[++i];
+            }
+            else if (arg == "--checkpoint-every" && hasValue) {
+                options.checkpointEvery = stoull(argv[++i]);
+            }
+            else if (arg == "--restore" && hasValue) {
+                options.restoreFile = argv[++i];
+            }
+            else if (arg == "--stats" && hasValue) {
+                options.statsFile = argv[++i];
+            }
+            else if (arg == "--verify") {
+                options.verify = true;
+            }
+            else {
+                throw invalid_argument("Nieznany argument: " + arg);
+            }
+        }
+        if (options.generationsPerFrame < 1) {
+            throw invalid_argument("Liczba pokolen na klatke musi byc dodatnia");
+        }
+
+        if (options.headless) {
+            return runHeadless(options);
+        }
+
+        int rows = options.rows == 0 ? 200 : options.rows;
+        int cols = options.cols == 0 ? 200 : options.cols;
+        CellGrid cells = initializeGrid(rows, cols);
+        Pattern pattern;
+
+        if (!options.patternFile.empty()) {
+            pattern = readPattern(options.patternFile);
+            placePattern(cells, pattern.cells);
+        }
+        else {
+            // Glider
+            placeGlider(cells);
+
+            // Oscylator
+            //placeToad(cells);
+
+            // Losowe
+           // cells = initializeRandomCells(rows, cols, 0.05, static_cast<uint64_t>(time(0)));
+
+            // Niezmienny
+           // cells = initializeStableBlock(rows, cols);
+        }
+
+        // Symulacja na siatce spakowanej bitowo (dwa bufory zamieniane po każdym kroku)
+        PackedGrid grid = packGrid(cells);
+        PackedGrid nextGrid(rows, cols);
+
+        // Liczone są tylko kafelki, w których (lub obok których) coś się dzieje
+        TileActivity activity(grid);
+
+        // Reguły kompilowane raz, przed symulacją: podana (lub z pliku) albo kolejno 40, 63, 26, 190
+        vector<RuleTable> compiledRules;
+        vector<string> ruleNames;
+        string ruleText = !options.rule.empty() ? options.rule : pattern.rule;
+        if (!ruleText.empty()) {
+            compiledRules.push_back(parseRule(ruleText));
+            ruleNames.push_back(formatRule(compiledRules.back()));
+        }
+        else {
+            for (int rule : rules) {
+                compiledRules.push_back(compileRule(legacyRule(rule)));
+                ruleNames.push_back(to_string(rule));
+            }
+        }
+
+        // Tworzenie okna SFML
+        sf::RenderWindow window(sf::VideoMode(cols * CELL_SIZE, rows * CELL_SIZE), "Automat Komorkowy - Gra w Zycie - Reguła: " + ruleNames[currentRuleIndex]);
+        GridRenderer renderer(rows, cols);
+        ParallelLifeStepper parallel(options.threads);
+        int step = 0; // Pokolenie w obrębie bieżącej reguły
+
+        // Świat nieograniczony (--engine chunked): okno pokazuje wycinek rows x cols
+        // zaczynający się w (viewTop, viewLeft); strzałki przesuwają widok, spacja
+        // wyśrodkowuje go na żywych komórkach
+        unique_ptr<ChunkedWorld> world;
+        PackedGrid view(rows, cols);
+        int64_t viewTop = 0, viewLeft = 0;
+        if (options.engine == "chunked") {
+            world.reset(new ChunkedWorld(compiledRules[currentRuleIndex]));
+            world->load(cells);
+        }
+
+        while (window.isOpen()) {
+            sf::Event event;
+            while (window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed)
+                    window.close(); 
+                if (world && event.type == sf::Event::KeyPressed) {
+                    const int PAN = CHUNK_SIZE / 4;
+                    if (event.key.code == sf::Keyboard::Left) viewLeft -= PAN;
+                    if (event.key.code == sf::Keyboard::Right) viewLeft += PAN;
+                    if (event.key.code == sf::Keyboard::Up) viewTop -= PAN;
+                    if (event.key.code == sf::Keyboard::Down) viewTop += PAN;
+                    int64_t top, left, bottom, right;
+                    if (event.key.code == sf::Keyboard::Space && world->bounds(top, left, bottom, right)) {
+                        viewTop = (top + bottom) / 2 - rows / 2;
+                        viewLeft = (left + right) / 2 - cols / 2;
+                    }
+                }
+            }
+
+            //cout << "Aktualna reguła: " << rules[currentRuleIndex] << endl;
+
+            // Kilka pokoleń na klatkę; reguła zmienia się co steps pokoleń niezależnie od rysowania
+            for (int remaining = options.generationsPerFrame; remaining > 0;) {
+                int count = min(remaining, steps - step);
+                if (world) {
+                    for (int generation = 0; generation < count; ++generation) world->step();
+                }
+                else if (parallel.threads() > 1) {
+                    parallel.advance(grid, nextGrid, compiledRules[currentRuleIndex], options.boundary, count);
+                }
+                else {
+                    for (int generation = 0; generation < count; ++generation) {
+                        updateActiveTiles(grid, nextGrid, compiledRules[currentRuleIndex], options.boundary, activity);
+                        swap(grid, nextGrid);
+                    }
+                }
+                remaining -= count;
+                step += count;
+
+                if (step == steps) {
+                    step = 0;
+                    currentRuleIndex = (currentRuleIndex + 1) % compiledRules.size();
+                    activity.markAll(); // Nowa reguła może ożywić stabilne obszary
+                    if (world) world->setRule(compiledRules[currentRuleIndex]);
+                    // cells = initializeCells(rows, cols); // Inicjalizacja nowych komórek
+                }
+            }
+
+            window.clear(); 
+            if (world) {
+                world->copyViewport(view, viewTop, viewLeft);
+                renderer.draw(window, view);
+            }
+            else {
+                renderer.draw(window, grid);
+            }
+            updateWindowTitle(window, ruleNames[currentRuleIndex]);
+            window.display();
         }
     }
     catch (const exception& e) {
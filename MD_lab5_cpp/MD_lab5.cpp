@@ -3,164 +3,804 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "CounterRng.h"
 
 // Stałe rozmiary
 const int TILE_SIZE = 1;  // Rozmiar pojedynczego kwadratu w pikselach
 
-// Stany drzewa
-enum TreeState { Healthy, Burning, Burned, Water, Empty };
+// Stany komórki (jeden bajt na komórkę w płaszczyźnie stanów)
+enum TreeState : uint8_t { Healthy, Burning, Burned, Water, Empty };
 
-// Struktura reprezentująca drzewo
-struct Tree {
-    TreeState state;
-    sf::Color color;
+// Odcienie komórki (drugi bajt): numer koloru w obrębie stanu
+enum Shade : uint8_t {
+    DefaultShade = 0,  // Zielony drzewa spoza mapy, pierwszy odcień wody
+    DarkGreen = 1,
+    LightGreen = 2,
+    PaleGreen = 3,
+    SecondWater = 1
+};
 
-    Tree() : state(Healthy), color(sf::Color::Green) {}
+// Las jako dwie ciągłe płaszczyzny bajtów: stan i odcień komórki (y, x) leżą pod
+// indeksem y * width + x. Kolor nie jest przechowywany - wynika ze stanu i odcienia
+// dopiero przy rysowaniu
+struct Forest {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> shade;
 
-    void ignite() {
-        if (state == Healthy) {
-            state = Burning;
-            color = sf::Color::Red; // Kolor ognia
-        }
+    Forest(int width, int height)
+        : width(width), height(height), state(size_t(width) * height, Healthy), shade(size_t(width) * height, DefaultShade) {}
+
+    size_t index(int y, int x) const { return size_t(y) * width + x; }
+
+    void set(int y, int x, TreeState newState, uint8_t newShade) {
+        state[index(y, x)] = newState;
+        shade[index(y, x)] = newShade;
+    }
+};
+
+// Obraz jako ciągły bufor RGBA (4 bajty na piksel, wiersz po wierszu)
+struct RawImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Zmniejszenie obrazu factor razy filtrem pudełkowym: piksel wyniku to zaokrąglona średnia
+// bloku factor x factor. Liczone na surowym buforze, pasami wierszy w wielu wątkach;
+// jednolity blok (np. wnętrze jeziora) zachowuje dokładnie swój kolor
+RawImage downscaleImage(const sf::Image& image, int factor, unsigned threads = 0) {
+    if (factor < 1) {
+        throw std::invalid_argument("Wspolczynnik zmniejszenia musi byc dodatni");
     }
+    RawImage result;
+    result.width = image.getSize().x / factor;
+    result.height = image.getSize().y / factor;
+    if (result.width == 0 || result.height == 0) {
+        throw std::runtime_error("Obraz jest mniejszy niz wspolczynnik zmniejszenia");
+    }
+    result.pixels.resize(size_t(result.width) * result.height * 4);
 
-    void burn() {
-        if (state == Burning) {
-            state = Burned;
-            color = sf::Color::Black; // Spalone drzewo
+    const uint8_t* source = image.getPixelsPtr();
+    size_t sourceStride = size_t(image.getSize().x) * 4;
+    if (factor == 1) {
+        for (int y = 0; y < result.height; ++y) {
+            std::memcpy(&result.pixels[size_t(y) * result.width * 4], source + y * sourceStride, size_t(result.width) * 4);
         }
+        return result;
     }
-};
 
-// Funkcja do wczytania obrazu i stworzenia mapy terenu
-void initializeForestFromImage(std::vector<std::vector<Tree>>& forest, const sf::Image& image) {
-    for (int y = 0; y < image.getSize().y; ++y) {
-        for (int x = 0; x < image.getSize().x; ++x) {
-            sf::Color pixelColor = image.getPixel(x, y);
-
-            // Jeśli kolor jest głównie zielony (drzewo)
-            if (pixelColor.g > pixelColor.r && pixelColor.g > pixelColor.b && pixelColor.g > 100) {
-                // Dodajemy różne odcienie zielonego
-                if (pixelColor.g > 150) {
-                    forest[y][x].state = Healthy;
-                    forest[y][x].color = sf::Color(34, 139, 34);  // Ciemniejszy zielony
-                }
-                else if (pixelColor.g > 120) {
-                    forest[y][x].state = Healthy;
-                    forest[y][x].color = sf::Color(50, 205, 50);  // Jaśniejszy zielony
-                }
-                else {
-                    forest[y][x].state = Healthy;
-                    forest[y][x].color = sf::Color(0, 128, 0);  // Mniej intensywny zielony
+    uint32_t area = uint32_t(factor) * factor;
+    parallelFor(result.height, [&](size_t begin, size_t end) {
+        std::vector<uint32_t> sums(size_t(result.width) * 4);
+        for (size_t y = begin; y < end; ++y) {
+            std::fill(sums.begin(), sums.end(), 0);
+            for (int dy = 0; dy < factor; ++dy) {
+                const uint8_t* row = source + (y * factor + dy) * sourceStride;
+                for (int x = 0; x < result.width; ++x) {
+                    uint32_t* sum = &sums[size_t(x) * 4];
+                    const uint8_t* pixel = row + size_t(x) * factor * 4;
+                    for (int dx = 0; dx < factor; ++dx, pixel += 4) {
+                        sum[0] += pixel[0];
+                        sum[1] += pixel[1];
+                        sum[2] += pixel[2];
+                        sum[3] += pixel[3];
+                    }
                 }
             }
-            // Jeśli kolor jest brązowy (spalony teren)
-            else if (pixelColor.r > 80 && pixelColor.g < 50 && pixelColor.b < 30) {
-                forest[y][x].state = Burned;
-                forest[y][x].color = sf::Color::Black;
-            }
-            // Jeśli kolor jest jednym z odcieni wody
-            else if ((pixelColor.r == 138 && pixelColor.g == 216 && pixelColor.b == 236) ||
-                (pixelColor.r == 122 && pixelColor.g == 213 && pixelColor.b == 233)) {
-                forest[y][x].state = Water;
-                forest[y][x].color = pixelColor;  // Kolor wody z obrazu (może być jeden z dwóch)
-            }
-            // Jeśli kolor jest inny (np. pusty teren)
-            else {
-                forest[y][x].state = Empty;
-                forest[y][x].color = sf::Color::White;
+            uint8_t* out = &result.pixels[y * result.width * 4];
+            for (size_t i = 0; i < sums.size(); ++i) {
+                out[i] = uint8_t((sums[i] + area / 2) / area);
             }
         }
+    }, threads);
+    return result;
+}
+
+// Funkcja do stworzenia mapy terenu z obrazu. Piksele klasyfikowane są na surowym buforze
+// bez rozgałęzień (wybory przez operator ?: kompilator zamienia na maski, więc pętla daje
+// się zwektoryzować), odcień zieleni pochodzi z tablicy według składowej g, a obraz jest
+// dzielony między wątki
+void initializeForestFromImage(Forest& forest, const RawImage& image, unsigned threads = 0) {
+    uint8_t greenShade[256];
+    for (int g = 0; g < 256; ++g) {
+        // Dodajemy różne odcienie zielonego
+        greenShade[g] = g > 150 ? DarkGreen : g > 120 ? LightGreen : PaleGreen;
     }
 
+    parallelFor(forest.state.size(), [&](size_t begin, size_t end) {
+        const uint8_t* pixel = image.pixels.data() + begin * 4;
+        uint8_t* state = forest.state.data();
+        uint8_t* shade = forest.shade.data();
+        for (size_t cell = begin; cell < end; ++cell, pixel += 4) {
+            uint8_t r = pixel[0], g = pixel[1], b = pixel[2];
+            // Głównie zielony - drzewo; brązowy - spalony teren; dwa odcienie wody; reszta pusta
+            bool isTree = g > r && g > b && g > 100;
+            bool isBurned = r > 80 && g < 50 && b < 30;
+            bool isWater = r == 138 && g == 216 && b == 236;
+            bool isSecondWater = r == 122 && g == 213 && b == 233;
+            state[cell] = isTree ? Healthy : isBurned ? Burned : isWater || isSecondWater ? Water : Empty;
+            shade[cell] = isTree ? greenShade[g] : isSecondWater ? uint8_t(SecondWater) : uint8_t(DefaultShade);
+        }
+    }, threads);
+
     // Rozpal środek
-    forest[image.getSize().y / 2][image.getSize().x / 2].ignite();
+    size_t center = forest.index(forest.height / 2, forest.width / 2);
+    if (forest.state[center] == Healthy) forest.state[center] = Burning;
+}
+
+// Front pożaru: drzewa płonące w bieżącym kroku i drzewa zapalone w nim, które będą
+// płonąć w następnym (indeksy komórek). Krok kosztuje tyle, ile drzew na froncie, a nie cały las.
+// Po spreadFire burning to drzewa zapalone w tym kroku, a ignited - spalone w nim (do następnego kroku)
+struct FireFront {
+    std::vector<uint32_t> burning;
+    std::vector<uint32_t> ignited;
+
+    bool empty() const { return burning.empty(); }
+};
+
+// Początkowy front: jedno przejście po płaszczyźnie stanów (później front jest tylko aktualizowany)
+FireFront collectFireFront(const Forest& forest) {
+    FireFront front;
+    for (size_t cell = 0; cell < forest.state.size(); ++cell) {
+        if (forest.state[cell] == Burning) {
+            front.burning.push_back(uint32_t(cell));
+        }
+    }
+    return front;
+}
+
+// Kierunki w kolejności pętli spreadFire (d = 0..7): wiersz -1, 0, 1, w nim kolumna -1, 0, 1
+const int DIRECTION_DY[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+const int DIRECTION_DX[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+
+// Parametry modelu rozprzestrzeniania ognia. Prawdopodobieństwo przejścia z płonącej komórki
+// na sąsiada w kierunku d to baseProbability * paliwo sąsiada * wiatr(d) * nachylenie,
+// obcięte do [0, 1]. Przy braku wiatru, płaskim terenie i paliwie 1 to dawne stałe 70%
+struct FireModel {
+    double baseProbability = 0.70;
+    // Paliwo według odcienia zdrowego drzewa (DefaultShade, DarkGreen, LightGreen, PaleGreen):
+    // najbardziej zielone piksele mapy (DarkGreen, g > 150) to gęsty drzewostan, najmniej
+    // zielone (PaleGreen, g <= 120) - rzadki; drzewa spoza mapy mają paliwo 1. Zmiana: --fuel
+    double fuelFactor[4] = { 1.0, 1.15, 1.0, 0.8 };
+    double windSpeed = 0.0;          // m/s
+    double windDirection = 0.0;      // Stopnie zgodnie ze wskazówkami zegara od północy (góra mapy), kierunek, w którym wieje
+    double windCoefficient = 0.15;   // exp(windCoefficient * prędkość * cos kąta między kierunkiem a wiatrem)
+    double slopeCoefficient = 0.05;  // exp(slopeCoefficient * wzniesienie / odległość), wzniesienie w poziomach mapy wysokości
+    std::vector<uint8_t> elevation;  // Wysokość komórki (0-255); pusty - teren płaski
+};
+
+// Progi zapłonu skompilowane z modelu: bajt thresholds[8 * komórka + d] to szansa przejścia
+// ognia z komórki w kierunku d w 1/256 (próg dla najstarszych 8 bitów losowania). Krok
+// symulacji robi tylko odczyt progu i jedno porównanie
+struct IgnitionTable {
+    std::vector<uint8_t> thresholds;
+};
+
+// Szansa przejścia ognia jako próg w 1/256, obcięta do [0, 255]
+uint8_t ignitionThreshold(double p) {
+    return uint8_t(std::min(255L, std::max(0L, std::lround(p * 256.0))));
 }
 
-// Funkcja do rozprzestrzeniania ognia
-void spreadFire(std::vector<std::vector<Tree>>& forest) {
-    std::vector<std::pair<int, int>> fireSpreading;
+// Kompilacja progów. Funkcje przestępne liczone są tylko dla tablic: 8 czynników wiatru
+// i 2 x 511 czynników nachylenia (różnica wysokości -255..255, sąsiad prosto lub po skosie),
+// więc ponowna kompilacja po zmianie wiatru to jedno przejście z odczytami z tablic
+void compileIgnition(const Forest& forest, const FireModel& model, IgnitionTable& table, unsigned threads = 0) {
+    const double PI = 3.14159265358979323846;
+    if (!model.elevation.empty() && model.elevation.size() != forest.state.size()) {
+        throw std::invalid_argument("Mapa wysokosci ma inny rozmiar niz las");
+    }
+
+    double windX = std::sin(model.windDirection * PI / 180.0);
+    double windY = -std::cos(model.windDirection * PI / 180.0);
+    double directional[8];
+    for (int d = 0; d < 8; ++d) {
+        double length = std::sqrt(double(DIRECTION_DX[d] * DIRECTION_DX[d] + DIRECTION_DY[d] * DIRECTION_DY[d]));
+        double cosine = (DIRECTION_DX[d] * windX + DIRECTION_DY[d] * windY) / length;
+        directional[d] = model.baseProbability * std::exp(model.windCoefficient * model.windSpeed * cosine);
+    }
+
+    std::vector<double> slope[2];
+    for (int diagonal = 0; diagonal < 2; ++diagonal) {
+        slope[diagonal].resize(511);
+        for (int rise = -255; rise <= 255; ++rise) {
+            slope[diagonal][rise + 255] = std::exp(model.slopeCoefficient * rise / (diagonal ? std::sqrt(2.0) : 1.0));
+        }
+    }
 
-    // Zbieramy wszystkie drzewa, które się palą
-    for (int y = 0; y < forest.size(); ++y) {
-        for (int x = 0; x < forest[y].size(); ++x) {
-            if (forest[y][x].state == Burning) {
-                fireSpreading.push_back({ y, x });
+    table.thresholds.resize(forest.state.size() * 8);
+    parallelFor(forest.height, [&](size_t begin, size_t end) {
+        for (int y = int(begin); y < int(end); ++y) {
+            for (int x = 0; x < forest.width; ++x) {
+                size_t cell = forest.index(y, x);
+                uint8_t* threshold = &table.thresholds[cell * 8];
+                for (int d = 0; d < 8; ++d) {
+                    int ny = y + DIRECTION_DY[d];
+                    int nx = x + DIRECTION_DX[d];
+                    if (ny < 0 || ny >= forest.height || nx < 0 || nx >= forest.width) {
+                        threshold[d] = 0;
+                        continue;
+                    }
+                    size_t neighbor = forest.index(ny, nx);
+                    double p = directional[d] * model.fuelFactor[forest.shade[neighbor] & 3];
+                    if (!model.elevation.empty()) {
+                        int rise = int(model.elevation[neighbor]) - int(model.elevation[cell]);
+                        p *= slope[DIRECTION_DX[d] != 0 && DIRECTION_DY[d] != 0][rise + 255];
+                    }
+                    threshold[d] = ignitionThreshold(p);
+                }
             }
         }
+    }, threads);
+}
+
+// Mapa wysokości z obrazu (jasność, po zmniejszeniu tym samym współczynnikiem co mapa lasu)
+std::vector<uint8_t> elevationFromImage(const RawImage& image) {
+    std::vector<uint8_t> elevation(size_t(image.width) * image.height);
+    for (size_t cell = 0; cell < elevation.size(); ++cell) {
+        const uint8_t* pixel = &image.pixels[cell * 4];
+        elevation[cell] = uint8_t((pixel[0] * 77 + pixel[1] * 150 + pixel[2] * 29) >> 8);
     }
+    return elevation;
+}
 
-    // Zbiór komórek, które zostały zapalone w tej turze
-    std::vector<std::pair<int, int>> newlyIgnited;
+// Funkcja do rozprzestrzeniania ognia. Losowanie zależy tylko od (ziarno, krok,
+// płonąca komórka, kierunek), więc przebieg jest powtarzalny dla danego ziarna;
+// wynik nie zależy od kolejności drzew na froncie. Szanse przejścia pochodzą
+// ze skompilowanej tablicy progów
+void spreadFire(Forest& forest, const IgnitionTable& ignition, FireFront& front, const CounterRng& rng, uint64_t step) {
+    front.ignited.clear();
+    uint8_t* state = forest.state.data();
 
     // Rozprzestrzenianie ognia na sąsiednie drzewa
-    for (auto& fire : fireSpreading) {
-        int y = fire.first;
-        int x = fire.second;
+    for (uint32_t cell : front.burning) {
+        int y = cell / forest.width;
+        int x = cell % forest.width;
+        int direction = 0;
+        const uint8_t* threshold = &ignition.thresholds[size_t(cell) * 8];
 
         // Sprawdź sąsiednie komórki (góra, dół, lewo, prawo)
         for (int dy = -1; dy <= 1; ++dy) {
             for (int dx = -1; dx <= 1; ++dx) {
                 if (dy == 0 && dx == 0) continue; // Pomijamy siebie
+                int d = direction++;
 
                 int ny = y + dy;
                 int nx = x + dx;
 
-                if (ny >= 0 && ny < forest.size() && nx >= 0 && nx < forest[0].size()) {
-                    if (forest[ny][nx].state == Healthy && forest[ny][nx].state != Water) {
-                        // 70% szans, że ogień się rozprzestrzeni, ale nie na wodzie
-                        if (rand() % 100 < 70) {
-                            forest[ny][nx].ignite();
-                            newlyIgnited.push_back({ ny, nx });
-                        }
+                if (ny >= 0 && ny < forest.height && nx >= 0 && nx < forest.width) {
+                    size_t neighbor = forest.index(ny, nx);
+                    // Ogień przechodzi z szansą threshold[d] / 256 (tylko na zdrowe drzewo, nie na wodę)
+                    if (state[neighbor] == Healthy && (rng.bits(uint64_t(cell) * 2 + d / 4, step, d % 4) >> 24) < threshold[d]) {
+                        state[neighbor] = Burning;
+                        front.ignited.push_back(uint32_t(neighbor));
                     }
                 }
             }
         }
 
         // Spal drzewa
-        forest[y][x].burn();
+        state[cell] = Burned;
+    }
+
+    // Zapalone w tym kroku płoną w następnym
+    std::swap(front.burning, front.ignited);
+}
+
+// Czasy zapłonu jednego pożaru bez symulacji krok po kroku
+const uint32_t NOT_BURNED = UINT32_MAX;
+
+struct ArrivalMap {
+    std::vector<uint32_t> arrival;  // Krok, w którym komórka się zapaliła (0 - ognisko); NOT_BURNED - nie spłonęła
+    std::vector<uint32_t> order;    // Spalone komórki w kolejności zapłonu (blizna pożaru)
+    uint32_t duration = 0;          // Liczba kroków do wygaśnięcia, jak w symulacji krokowej
+};
+
+// Dijkstra od ognisk po grafie sąsiedztwa z losowymi opóźnieniami krawędzi. Płonąca komórka ma
+// jedną próbę na każdego sąsiada, w kroku, w którym płonie, więc opóźnienie krawędzi to 1
+// (losowanie jak w spreadFire, z tym samym licznikiem) albo nieskończoność. Przy takich wagach
+// kolejka priorytetowa jest kolejką FIFO: komórki trafiają do order w niemalejącym czasie.
+// Każda komórka jest odwiedzana raz, bez płaszczyzny stanów i bez kroków; dla tego samego
+// generatora wynik jest identyczny z pożarem liczonym przez spreadFire od kroku 0.
+// Tablica arrival jest zerowana tylko w komórkach poprzedniego pożaru (wielokrotne użycie map)
+void solveArrivalTimes(const Forest& forest, const IgnitionTable& ignition, const std::vector<uint32_t>& sources,
+    const CounterRng& rng, ArrivalMap& map) {
+    if (map.arrival.size() != forest.state.size()) {
+        map.arrival.assign(forest.state.size(), NOT_BURNED);
+    }
+    else {
+        for (uint32_t cell : map.order) map.arrival[cell] = NOT_BURNED;
+    }
+    map.order.clear();
+    for (uint32_t cell : sources) {
+        if (map.arrival[cell] == NOT_BURNED) {
+            map.arrival[cell] = 0;
+            map.order.push_back(cell);
+        }
+    }
+
+    const uint8_t* state = forest.state.data();
+    uint32_t* arrival = map.arrival.data();
+    for (size_t next = 0; next < map.order.size(); ++next) {
+        uint32_t cell = map.order[next];
+        uint32_t time = arrival[cell];
+        int y = cell / forest.width;
+        int x = cell % forest.width;
+        const uint8_t* threshold = &ignition.thresholds[size_t(cell) * 8];
+        for (int d = 0; d < 8; ++d) {
+            int ny = y + DIRECTION_DY[d];
+            int nx = x + DIRECTION_DX[d];
+            if (ny < 0 || ny >= forest.height || nx < 0 || nx >= forest.width) continue;
+            size_t neighbor = forest.index(ny, nx);
+            if (state[neighbor] == Healthy && arrival[neighbor] == NOT_BURNED
+                && (rng.bits(uint64_t(cell) * 2 + d / 4, time, d % 4) >> 24) < threshold[d]) {
+                arrival[neighbor] = time + 1;
+                map.order.push_back(uint32_t(neighbor));
+            }
+        }
     }
+    map.duration = map.order.empty() ? 0 : arrival[map.order.back()] + 1;
+}
+
+// Silnik pożaru w zespole: symulacja krokowa (spreadFire) albo czasy zapłonu (solveArrivalTimes)
+enum class SpreadEngine { Stepped, Arrival };
+
+// Wyniki zespołu niezależnych przebiegów pożaru na tym samym terenie
+struct EnsembleResult {
+    int width = 0;
+    int height = 0;
+    uint64_t runs = 0;
+    std::vector<uint32_t> burnCount;   // W ilu przebiegach komórka spłonęła
+    std::vector<uint64_t> arrivalSum;  // Suma kroków, w których się zapaliła (0 - ognisko)
+    std::vector<uint64_t> burnedArea;  // Liczba spalonych komórek w każdym przebiegu
+    std::vector<uint64_t> duration;    // Liczba kroków do wygaśnięcia w każdym przebiegu
+
+    double probability(size_t cell) const { return runs ? double(burnCount[cell]) / runs : 0.0; }
+    double meanArrival(size_t cell) const { return burnCount[cell] ? double(arrivalSum[cell]) / burnCount[cell] : -1.0; }
+};
+
+// Generator przebiegu run: własny klucz Philox wyprowadzony z ziarna, więc przebiegi są
+// niezależne i każdy da się powtórzyć osobno, niezależnie od liczby wątków
+CounterRng ensembleMember(const CounterRng& rng, uint64_t run) {
+    uint32_t key[4];
+    rng.block(run, ~uint64_t(0), key);
+    return CounterRng((uint64_t(key[1]) << 32) | key[0]);
+}
+
+// Zespół runs pożarów w threads wątkach. Teren jest tylko czytany; każdy wątek ma własną
+// płaszczyznę stanów, którą po przebiegu przywraca tylko w komórkach, które się paliły
+// (koszt przebiegu zależy od spalonego obszaru, a nie od mapy). Częstości i czasy zapłonu
+// wątek liczy we własnych tablicach (bez zapisów współdzielonych w pętli przebiegu - wszystkie
+// przebiegi palą prawie ten sam obszar), sumowanych po zakończeniu wszystkich przebiegów.
+// Sumy nie zależą od podziału przebiegów między wątki. Oba silniki dają te same wyniki
+EnsembleResult runEnsemble(const Forest& terrain, const IgnitionTable& ignition, const CounterRng& rng, uint64_t runs,
+    unsigned threads, SpreadEngine engine = SpreadEngine::Stepped) {
+    size_t cells = terrain.state.size();
+    FireFront initial = collectFireFront(terrain);
+
+    EnsembleResult result;
+    result.width = terrain.width;
+    result.height = terrain.height;
+    result.runs = runs;
+    result.burnedArea.resize(runs);
+    result.duration.resize(runs);
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<uint64_t> nextRun(0);
+    std::vector<std::vector<uint32_t>> workerCounts(threads);
+    std::vector<std::vector<uint64_t>> workerSums(threads);
+    parallelFor(threads, [&](size_t worker, size_t) {
+        std::vector<uint32_t>& burnCount = workerCounts[worker];
+        std::vector<uint64_t>& arrivalSum = workerSums[worker];
+        burnCount.assign(cells, 0);
+        arrivalSum.assign(cells, 0);
+        Forest forest = terrain;
+        FireFront front;
+        std::vector<uint32_t> touched;
+        ArrivalMap arrivals;
+        for (uint64_t run; (run = nextRun.fetch_add(1, std::memory_order_relaxed)) < runs;) {
+            CounterRng member = ensembleMember(rng, run);
+            if (engine == SpreadEngine::Arrival) {
+                solveArrivalTimes(terrain, ignition, initial.burning, member, arrivals);
+                for (uint32_t cell : arrivals.order) {
+                    ++burnCount[cell];
+                    arrivalSum[cell] += arrivals.arrival[cell];
+                }
+                result.burnedArea[run] = arrivals.order.size();
+                result.duration[run] = arrivals.duration;
+                continue;
+            }
+
+            front.burning = initial.burning;
+            touched = initial.burning;
+            for (uint32_t cell : front.burning) {
+                ++burnCount[cell];
+            }
+
+            uint64_t step = 0;
+            while (!front.empty()) {
+                spreadFire(forest, ignition, front, member, step++);
+                for (uint32_t cell : front.burning) {
+                    ++burnCount[cell];
+                    arrivalSum[cell] += step;
+                }
+                touched.insert(touched.end(), front.burning.begin(), front.burning.end());
+            }
+
+            result.burnedArea[run] = touched.size();
+            result.duration[run] = step;
+            for (uint32_t cell : touched) forest.state[cell] = terrain.state[cell];
+        }
+    }, threads);
+
+    // Suma tablic wątków, równolegle po zakresach komórek
+    result.burnCount.assign(cells, 0);
+    result.arrivalSum.assign(cells, 0);
+    parallelFor(cells, [&](size_t begin, size_t end) {
+        for (unsigned worker = 0; worker < threads; ++worker) {
+            const uint32_t* count = workerCounts[worker].data();
+            const uint64_t* sum = workerSums[worker].data();
+            for (size_t cell = begin; cell < end; ++cell) {
+                result.burnCount[cell] += count[cell];
+                result.arrivalSum[cell] += sum[cell];
+            }
+        }
+    }, threads);
+    return result;
 }
 
-// Funkcja do rysowania lasu
-void drawForest(sf::RenderWindow& window, const std::vector<std::vector<Tree>>& forest) {
-    for (int y = 0; y < forest.size(); ++y) {
-        for (int x = 0; x < forest[y].size(); ++x) {
-            sf::RectangleShape tile(sf::Vector2f(TILE_SIZE, TILE_SIZE));
-            tile.setPosition(x * TILE_SIZE, y * TILE_SIZE);
-            tile.setFillColor(forest[y][x].color);
-            window.draw(tile);
+// Raster prawdopodobieństwa spłonięcia (jasność = prawdopodobieństwo) i średniego kroku
+// zapłonu (jasność maleje z czasem, czarne - nie spłonęło nigdy)
+void saveEnsembleRasters(const EnsembleResult& result, const std::string& prefix) {
+    double latest = 1.0;
+    for (size_t cell = 0; cell < result.burnCount.size(); ++cell) {
+        latest = std::max(latest, result.meanArrival(cell));
+    }
+
+    sf::Image probability, arrival;
+    probability.create(result.width, result.height);
+    arrival.create(result.width, result.height);
+    for (int y = 0; y < result.height; ++y) {
+        for (int x = 0; x < result.width; ++x) {
+            size_t cell = size_t(y) * result.width + x;
+            sf::Uint8 p = sf::Uint8(std::lround(255 * result.probability(cell)));
+            probability.setPixel(x, y, sf::Color(p, p, p));
+            double t = result.meanArrival(cell);
+            sf::Uint8 a = t < 0 ? 0 : sf::Uint8(std::lround(255 - 200 * t / latest));
+            arrival.setPixel(x, y, sf::Color(a, a, a));
         }
     }
+    if (!probability.saveToFile(prefix + "_prawdopodobienstwo.png") || !arrival.saveToFile(prefix + "_czas.png")) {
+        throw std::runtime_error("Nie mozna zapisac rastrow: " + prefix);
+    }
+}
+
+// Podsumowanie zespołu: rozkład spalonego obszaru i czasu trwania
+void printEnsembleSummary(const EnsembleResult& result, double seconds) {
+    double areaMean = 0, areaSquares = 0, durationMean = 0;
+    for (uint64_t run = 0; run < result.runs; ++run) {
+        areaMean += double(result.burnedArea[run]);
+        areaSquares += double(result.burnedArea[run]) * double(result.burnedArea[run]);
+        durationMean += double(result.duration[run]);
+    }
+    areaMean /= result.runs;
+    durationMean /= result.runs;
+    double areaDeviation = std::sqrt(std::max(0.0, areaSquares / result.runs - areaMean * areaMean));
+
+    size_t likely = 0, ever = 0;
+    for (size_t cell = 0; cell < result.burnCount.size(); ++cell) {
+        if (result.burnCount[cell] > 0) ++ever;
+        if (2 * uint64_t(result.burnCount[cell]) >= result.runs) ++likely;
+    }
+
+    std::cout << "Przebiegi: " << result.runs << ", czas: " << seconds << " s" << std::endl;
+    std::cout << "Spalony obszar: srednio " << areaMean << " (odch. std. " << areaDeviation << "), min "
+        << *std::min_element(result.burnedArea.begin(), result.burnedArea.end()) << ", max "
+        << *std::max_element(result.burnedArea.begin(), result.burnedArea.end()) << std::endl;
+    std::cout << "Czas trwania: srednio " << durationMean << " krokow, max "
+        << *std::max_element(result.duration.begin(), result.duration.end()) << std::endl;
+    std::cout << "Komorki spalone chociaz raz: " << ever << ", z prawdopodobienstwem >= 0.5: " << likely << std::endl;
+}
+
+// Paleta: kolor komórki to palette[(stan << SHADE_BITS) | odcień]
+const int SHADE_BITS = 2;
+const int PALETTE_SIZE = (Empty + 1) << SHADE_BITS;
+
+std::vector<sf::Color> makePalette() {
+    std::vector<sf::Color> palette(PALETTE_SIZE);
+    for (int shade = 0; shade < (1 << SHADE_BITS); ++shade) {
+        palette[(Healthy << SHADE_BITS) | shade] = sf::Color::Green;
+        palette[(Burning << SHADE_BITS) | shade] = sf::Color::Red;        // Kolor ognia
+        palette[(Burned << SHADE_BITS) | shade] = sf::Color::Black;       // Spalone drzewo
+        palette[(Water << SHADE_BITS) | shade] = sf::Color(138, 216, 236);
+        palette[(Empty << SHADE_BITS) | shade] = sf::Color::White;
+    }
+    palette[(Healthy << SHADE_BITS) | DarkGreen] = sf::Color(34, 139, 34);   // Ciemniejszy zielony
+    palette[(Healthy << SHADE_BITS) | LightGreen] = sf::Color(50, 205, 50);  // Jaśniejszy zielony
+    palette[(Healthy << SHADE_BITS) | PaleGreen] = sf::Color(0, 128, 0);     // Mniej intensywny zielony
+    palette[(Water << SHADE_BITS) | SecondWater] = sf::Color(122, 213, 233);
+    return palette;
 }
 
-int main() {
-    srand(static_cast<unsigned int>(time(0))); // Inicjalizacja generatora losowego
+// Obraz lasu: bufor pikseli RGBA (piksel na komórkę, kolory z palety) i, w oknie, tekstura
+// powiększana przez sprite do TILE_SIZE. Cały obraz liczy tylko refresh; po kroku update
+// przemalowuje komórki, które zmieniły stan (oba wektory frontu), i wysyła do tekstury tylko
+// zmienione odcinki wierszy, więc koszt klatki zależy od aktywności pożaru, a nie od mapy.
+// Bez okna (withTexture = false) tekstura nie powstaje, a obraz można zapisać do pliku
+class ForestRenderer {
+public:
+    ForestRenderer(int width, int height, bool withTexture = true)
+        : width(width), height(height), withTexture(withTexture), pixels(size_t(width) * height * 4),
+          rowMin(height, width), rowMax(height, -1) {
+        if (withTexture) {
+            if (!texture.create(width, height)) {
+                throw std::runtime_error("Nie udalo sie utworzyc tekstury");
+            }
+            sprite.setTexture(texture);
+            sprite.setScale(float(TILE_SIZE), float(TILE_SIZE));
+        }
+
+        std::vector<sf::Color> palette = makePalette();
+        for (int i = 0; i < PALETTE_SIZE; ++i) {
+            const sf::Uint8 rgba[4] = { palette[i].r, palette[i].g, palette[i].b, palette[i].a };
+            std::memcpy(&colors[i], rgba, 4);
+        }
+    }
+
+    // Pełne przeliczenie obrazu w jednym przejściu po obu płaszczyznach (pierwsza klatka)
+    void refresh(const Forest& forest) {
+        const uint8_t* state = forest.state.data();
+        const uint8_t* shade = forest.shade.data();
+        sf::Uint8* pixel = pixels.data();
+        for (size_t cell = 0; cell < forest.state.size(); ++cell, pixel += 4) {
+            std::memcpy(pixel, &colors[(state[cell] << SHADE_BITS) | shade[cell]], 4);
+        }
+        if (withTexture) texture.update(pixels.data());
+    }
+
+    // Przemalowanie komórek spalonych i zapalonych w ostatnim kroku; jedno wysłanie do tekstury
+    // na zmieniony wiersz (od pierwszej do ostatniej zmienionej komórki wiersza)
+    void update(const Forest& forest, const FireFront& front) {
+        paint(forest, front.ignited);
+        paint(forest, front.burning);
+        for (int y : dirtyRows) {
+            if (withTexture) {
+                texture.update(&pixels[(size_t(y) * width + rowMin[y]) * 4], rowMax[y] - rowMin[y] + 1, 1, rowMin[y], y);
+            }
+            rowMin[y] = width;
+            rowMax[y] = -1;
+        }
+        dirtyRows.clear();
+    }
+
+    void draw(sf::RenderWindow& window) {
+        window.draw(sprite);
+    }
+
+    void save(const std::string& path) const {
+        sf::Image image;
+        image.create(width, height, pixels.data());
+        if (!image.saveToFile(path)) {
+            throw std::runtime_error("Nie mozna zapisac obrazu: " + path);
+        }
+    }
+
+private:
+    void paint(const Forest& forest, const std::vector<uint32_t>& cells) {
+        for (uint32_t cell : cells) {
+            std::memcpy(&pixels[size_t(cell) * 4], &colors[(forest.state[cell] << SHADE_BITS) | forest.shade[cell]], 4);
+            int y = cell / width;
+            int x = cell % width;
+            if (rowMax[y] < 0) dirtyRows.push_back(y);
+            rowMin[y] = std::min(rowMin[y], x);
+            rowMax[y] = std::max(rowMax[y], x);
+        }
+    }
+
+    int width;
+    int height;
+    bool withTexture;
+    uint32_t colors[PALETTE_SIZE]; // Kolory palety jako gotowe piksele RGBA
+    std::vector<sf::Uint8> pixels;
+    std::vector<int> rowMin;       // Zakres zmienionych kolumn w wierszu (pusty: width, -1)
+    std::vector<int> rowMax;
+    std::vector<int> dirtyRows;    // Wiersze ze zmianami od ostatniego update
+    sf::Texture texture;
+    sf::Sprite sprite;
+};
+
+int main(int argc, char* argv[]) {
+    // Ziarno generatora: --seed <liczba> albo czas (wypisywany, żeby przebieg dało się powtórzyć).
+    // --ensemble N uruchamia N niezależnych pożarów bez okna (--threads, --out, --engine stepped|arrival);
+    // --verify liczy zespół obydwoma silnikami i porównuje wyniki; --headless liczy jeden pożar
+    // bez okna do wygaśnięcia i zapisuje końcowy obraz (--out). Model ognia: --wind <m/s> <stopnie>,
+    // --elevation <mapa wysokości>, --fuel <ciemny> <jasny> <blady> (mnożniki paliwa odcieni)
+    uint64_t seed = static_cast<uint64_t>(time(0));
+    uint64_t ensembleRuns = 0;
+    unsigned threads = 0;
+    std::string outPrefix = "pozar";
+    std::string mapFile = "mapaa1.png";
+    std::string elevationFile;
+    int scale = 2;
+    FireModel model;
+    SpreadEngine engine = SpreadEngine::Stepped;
+    bool verify = false;
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--ensemble" && i + 1 < argc) {
+            ensembleRuns = std::stoull(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc) {
+            outPrefix = argv[++i];
+        }
+        else if (arg == "--map" && i + 1 < argc) {
+            mapFile = argv[++i];
+        }
+        else if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stoi(argv[++i]);
+        }
+        else if (arg == "--fuel" && i + 3 < argc) {
+            for (int shade = DarkGreen; shade <= PaleGreen; ++shade) {
+                model.fuelFactor[shade] = std::stod(argv[++i]);
+            }
+        }
+        else if (arg == "--wind" && i + 2 < argc) {
+            model.windSpeed = std::stod(argv[++i]);
+            model.windDirection = std::stod(argv[++i]);
+        }
+        else if (arg == "--elevation" && i + 1 < argc) {
+            elevationFile = argv[++i];
+        }
+        else if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name != "stepped" && name != "arrival") {
+                std::cerr << "Nieznany silnik: " << name << std::endl;
+                return -1;
+            }
+            engine = name == "arrival" ? SpreadEngine::Arrival : SpreadEngine::Stepped;
+        }
+        else if (arg == "--verify") {
+            verify = true;
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+    }
+    std::cout << "Ziarno: " << seed << std::endl;
+    CounterRng rng(seed);
+    uint64_t step = 0;
 
     // Wczytanie obrazu
     sf::Image image;
-    if (!image.loadFromFile("mapaa1.png")) {
+    if (!image.loadFromFile(mapFile)) {
         std::cerr << "Błąd podczas wczytywania obrazu!" << std::endl;
         return -1;
     }
 
-    // Zmniejszenie rozdzielczości obrazu o połowę
-    sf::Image scaledImage;
-    scaledImage.create(image.getSize().x / 2, image.getSize().y / 2);
-    for (unsigned int y = 0; y < scaledImage.getSize().y; ++y) {
-        for (unsigned int x = 0; x < scaledImage.getSize().x; ++x) {
-            sf::Color color = image.getPixel(x * 2, y * 2);  // Wybieramy piksel co 2. (w przypadku zmniejszenia o połowę)
-            scaledImage.setPixel(x, y, color);
+    // Zmniejszenie rozdzielczości obrazu (domyślnie o połowę) i inicjalizacja lasu
+    auto ingestStart = std::chrono::steady_clock::now();
+    RawImage scaledImage;
+    try {
+        scaledImage = downscaleImage(image, scale, threads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Blad: " << e.what() << std::endl;
+        return -1;
+    }
+    Forest forest(scaledImage.width, scaledImage.height);
+    initializeForestFromImage(forest, scaledImage, threads);
+
+    // Model ognia: mapa wysokości (opcjonalna) i wiatr kompilowane do progów zapłonu
+    IgnitionTable ignition;
+    try {
+        if (!elevationFile.empty()) {
+            sf::Image elevationImage;
+            if (!elevationImage.loadFromFile(elevationFile)) {
+                throw std::runtime_error("Nie mozna wczytac mapy wysokosci: " + elevationFile);
+            }
+            model.elevation = elevationFromImage(downscaleImage(elevationImage, scale, threads));
+        }
+        compileIgnition(forest, model, ignition, threads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Blad: " << e.what() << std::endl;
+        return -1;
+    }
+    // Progi odcieni lasu przy braku wiatru i nachylenia - widać, jak działa paliwo
+    auto fuelThreshold = [&](int shade) { return int(ignitionThreshold(model.baseProbability * model.fuelFactor[shade])); };
+    std::cout << "Progi zaplonu (/256): ciemny " << fuelThreshold(DarkGreen) << ", jasny " << fuelThreshold(LightGreen)
+        << ", blady " << fuelThreshold(PaleGreen) << std::endl;
+    std::cout << "Mapa " << forest.width << "x" << forest.height << " w "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ingestStart).count() << " ms" << std::endl;
+
+    // Zespół przebiegów: teren wczytany raz, wyniki do rastrów i na standardowe wyjście
+    if (ensembleRuns > 0) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            EnsembleResult result = runEnsemble(forest, ignition, rng, ensembleRuns, threads, engine);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printEnsembleSummary(result, seconds);
+            saveEnsembleRasters(result, outPrefix);
+
+            // Porównanie z drugim silnikiem: te same przebiegi muszą dać te same liczniki
+            if (verify) {
+                SpreadEngine other = engine == SpreadEngine::Arrival ? SpreadEngine::Stepped : SpreadEngine::Arrival;
+                start = std::chrono::steady_clock::now();
+                EnsembleResult check = runEnsemble(forest, ignition, rng, ensembleRuns, threads, other);
+                double otherSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                size_t differences = 0;
+                for (size_t cell = 0; cell < result.burnCount.size(); ++cell) {
+                    if (result.burnCount[cell] != check.burnCount[cell] || result.arrivalSum[cell] != check.arrivalSum[cell]) {
+                        ++differences;
+                    }
+                }
+                bool runsMatch = result.burnedArea == check.burnedArea && result.duration == check.duration;
+                std::cout << "Weryfikacja: " << differences << " rozniacych sie komorek, przebiegi "
+                    << (runsMatch ? "zgodne" : "NIEZGODNE") << ", drugi silnik " << otherSeconds << " s" << std::endl;
+                if (differences != 0 || !runsMatch) return 1;
+            }
         }
+        catch (const std::exception& e) {
+            std::cerr << "Blad: " << e.what() << std::endl;
+            return -1;
+        }
+        return 0;
     }
 
-    // Tworzenie okna SFML
-    sf::RenderWindow window(sf::VideoMode(scaledImage.getSize().x * TILE_SIZE, scaledImage.getSize().y * TILE_SIZE), "Symulacja pożaru lasu");
+    // Jeden pożar bez okna: osobno czas kroków i aktualizacji obrazu (ta zależy od liczby
+    // zmienionych komórek), na końcu zapis obrazu
+    FireFront front = collectFireFront(forest);
+    if (headless) {
+        try {
+            ForestRenderer renderer(forest.width, forest.height, false);
+            renderer.refresh(forest);
+            double spreadSeconds = 0, drawSeconds = 0;
+            uint64_t changed = 0;
+            while (!front.empty()) {
+                auto start = std::chrono::steady_clock::now();
+                spreadFire(forest, ignition, front, rng, step++);
+                auto spread = std::chrono::steady_clock::now();
+                renderer.update(forest, front);
+                auto drawn = std::chrono::steady_clock::now();
+                spreadSeconds += std::chrono::duration<double>(spread - start).count();
+                drawSeconds += std::chrono::duration<double>(drawn - spread).count();
+                changed += front.ignited.size() + front.burning.size();
+            }
+            std::cout << "Pozar wygasl po " << step << " krokach" << std::endl;
+            std::cout << "Kroki: " << spreadSeconds * 1000 << " ms, obraz: " << drawSeconds * 1000 << " ms ("
+                << changed << " zmienionych komorek)" << std::endl;
+            renderer.save(outPrefix + "_koniec.png");
+            std::cout << "Zapisano: " << outPrefix << "_koniec.png" << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Blad: " << e.what() << std::endl;
+            return -1;
+        }
+        return 0;
+    }
 
-    // Inicjalizacja lasu na podstawie obrazu
-    std::vector<std::vector<Tree>> forest(scaledImage.getSize().y, std::vector<Tree>(scaledImage.getSize().x));
-    initializeForestFromImage(forest, scaledImage);
+    // Tworzenie okna SFML
+    sf::RenderWindow window(sf::VideoMode(forest.width * TILE_SIZE, forest.height * TILE_SIZE), "Symulacja pożaru lasu");
+    ForestRenderer renderer(forest.width, forest.height);
+    renderer.refresh(forest);
 
     // Pętla główna
     while (window.isOpen()) {
@@ -168,14 +808,35 @@ int main() {
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+
+            // Strzałki: lewo/prawo obracają wiatr o 15 stopni, góra/dół zmieniają prędkość o 1 m/s;
+            // progi zapłonu są kompilowane ponownie tylko po takiej zmianie
+            if (event.type == sf::Event::KeyPressed) {
+                bool windChanged = true;
+                if (event.key.code == sf::Keyboard::Left) model.windDirection = std::fmod(model.windDirection + 345.0, 360.0);
+                else if (event.key.code == sf::Keyboard::Right) model.windDirection = std::fmod(model.windDirection + 15.0, 360.0);
+                else if (event.key.code == sf::Keyboard::Up) model.windSpeed += 1.0;
+                else if (event.key.code == sf::Keyboard::Down) model.windSpeed = std::max(0.0, model.windSpeed - 1.0);
+                else windChanged = false;
+                if (windChanged) {
+                    compileIgnition(forest, model, ignition, threads);
+                    std::cout << "Wiatr: " << model.windSpeed << " m/s, kierunek " << model.windDirection << std::endl;
+                }
+            }
         }
 
-        // Rozprzestrzenianie ognia
-        spreadFire(forest);
+        // Rozprzestrzenianie ognia; symulacja zatrzymuje się, gdy front jest pusty
+        if (!front.empty()) {
+            spreadFire(forest, ignition, front, rng, step++);
+            renderer.update(forest, front);
+            if (front.empty()) {
+                std::cout << "Pozar wygasl po " << step << " krokach" << std::endl;
+            }
+        }
 
         // Rysowanie lasu
         window.clear();
-        drawForest(window, forest);
+        renderer.draw(window);
         window.display();
 
         // Brak opóźnienia - symulacja działa jak najszybciej
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Generator losowy oparty na liczniku (Philox4x32-10). Liczba losowa jest czystą
+// funkcją (ziarno, indeks, strumień), więc nie ma stanu współdzielonego między
+// wątkami, a wynik nie zależy od kolejności ani liczby wątków
+class CounterRng
+{
+public:
+    explicit CounterRng(uint64_t seed = 0) : seed(seed) {}
+
+    // Cztery 32-bitowe słowa dla licznika (index, stream)
+    void block(uint64_t index, uint64_t stream, uint32_t out[4]) const
+    {
+        uint32_t c0 = uint32_t(index), c1 = uint32_t(index >> 32);
+        uint32_t c2 = uint32_t(stream), c3 = uint32_t(stream >> 32);
+        uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+
+        for (int round = 0; round < 10; ++round)
+        {
+            uint64_t product0 = uint64_t(0xD2511F53u) * c0;
+            uint64_t product1 = uint64_t(0xCD9E8D57u) * c2;
+            uint32_t n0 = uint32_t(product1 >> 32) ^ c1 ^ k0;
+            uint32_t n1 = uint32_t(product1);
+            uint32_t n2 = uint32_t(product0 >> 32) ^ c3 ^ k1;
+            uint32_t n3 = uint32_t(product0);
+            c0 = n0;
+            c1 = n1;
+            c2 = n2;
+            c3 = n3;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+    // 32 losowe bity; lane (0-3) wybiera słowo z bloku
+    uint32_t bits(uint64_t index, uint64_t stream = 0, unsigned lane = 0) const
+    {
+        uint32_t out[4];
+        block(index, stream, out);
+        return out[lane & 3];
+    }
+
+    // Liczba z przedziału [0, 1)
+    double uniform(uint64_t index, uint64_t stream = 0, unsigned lane = 0) const
+    {
+        return bits(index, stream, lane) * (1.0 / 4294967296.0);
+    }
+
+    uint64_t getSeed() const { return seed; }
+
+    // Próg dla porównania bits(...) < próg z prawdopodobieństwem p
+    static uint64_t threshold(double p)
+    {
+        if (p <= 0.0)
+            return 0;
+        if (p >= 1.0)
+            return uint64_t(1) << 32;
+        return static_cast<uint64_t>(p * 4294967296.0);
+    }
+
+private:
+    uint64_t seed;
+};
+
+// Wywołanie body(begin, end) na rozłącznych fragmentach [0, count) w osobnych wątkach
+inline void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& body, unsigned threads = 0)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, count)));
+
+    if (threads == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    size_t chunk = (count + threads - 1) / threads;
+    for (size_t begin = 0; begin < count; begin += chunk)
+    {
+        size_t end = std::min(count, begin + chunk);
+        workers.emplace_back(body, begin, end);
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// Losowe komórki 0/1 (1 z prawdopodobieństwem p). Komórka o indeksie globalnym
+// firstIndex + i korzysta ze słowa (firstIndex + i) % 4 bloku (firstIndex + i) / 4
+template <class Cell>
+void fillBernoulli(Cell* cells, size_t count, double p, const CounterRng& rng, uint64_t firstIndex = 0, uint64_t stream = 0)
+{
+    uint64_t limit = CounterRng::threshold(p);
+    uint32_t words[4];
+    uint64_t currentBlock = ~uint64_t(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t index = firstIndex + i;
+        if (index / 4 != currentBlock)
+        {
+            currentBlock = index / 4;
+            rng.block(currentBlock, stream, words);
+        }
+        cells[i] = words[index % 4] < limit ? Cell(1) : Cell(0);
+    }
+}
+
+// To samo co fillBernoulli, ale rozłożone na wątki; wynik nie zależy od ich liczby
+template <class Cell>
+void parallelFillBernoulli(Cell* cells, size_t count, double p, const CounterRng& rng, uint64_t firstIndex = 0,
+    uint64_t stream = 0, unsigned threads = 0)
+{
+    parallelFor(count, [&](size_t begin, size_t end)
+    {
+        fillBernoulli(cells + begin, end - begin, p, rng, firstIndex + begin, stream);
+    }, threads);
+}